@@ -11,12 +11,16 @@ made by Darkness-TX
 #include <direct.h>
 #include <Windows.h>
 #include <locale.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/utime.h>
 
 typedef unsigned char  unit8;
 typedef unsigned short unit16;
 typedef unsigned int   unit32;
 
 unit32 FileNum = 0;//ļʼΪ0
+struct _utimbuf ArcTime;//ļͳһʹ÷޸ʱ䣬DDP2_packģʽݴжļǷ񱻸Ķ
 
 struct dheader
 {
@@ -145,7 +149,11 @@ void UnpackFile(char *fname)
 	FILE *src, *dst;
 	unit8 dstname[200], *cdata, *udata;
 	unit32 i = 0;
+	struct _stat ArcStat;
 	src = fopen(fname, "rb");
+	_stat(fname, &ArcStat);
+	ArcTime.actime = ArcStat.st_mtime;
+	ArcTime.modtime = ArcStat.st_mtime;
 	sprintf(dstname, "%s_unpack", fname);
 	fread(dat_header.magic, 4, 1, src);
 	if (strncmp(dat_header.magic, "DDP2", 4) != 0)
@@ -199,6 +207,7 @@ void UnpackFile(char *fname)
 		fwrite(udata, Index[i].uncomprlen, 1, dst);
 		free(udata);
 		fclose(dst);
+		_utime(dstname, &ArcTime);
 		FileNum++;
 	}
 	fclose(src);
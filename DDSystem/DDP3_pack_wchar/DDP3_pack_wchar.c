@@ -139,6 +139,167 @@ void ddp_uncompress(unit8 *uncompr, unit32 uncomprlen, unit8 *compr, unit32 comp
 	}
 }
 
+#define DDP_MAX_OFFSET 8192
+#define DDP_MAX_MATCH 0x10104//0xFEչܱʾֵ
+#define DDP_NICE_MATCH 256//ҵôƥֱӲãмλõ
+#define DDP_HASH_BITS 16
+#define DDP_MAX_CHAIN 64
+
+//ddp_uncompressıһƥҪõֽŽ
+unit32 MatchPrice(unit32 len, unit32 offset)
+{
+	if (len <= 6)
+		return offset <= 8 ? 1 : 2;
+	if (len <= 38 && offset <= 256)
+		return 2;
+	return len <= 260 ? 3 : 5;
+}
+
+unit8* PutLiteral(unit8 *out, unit8 *src, unit32 count)
+{
+	if (count <= 0x1D)
+		*out++ = count - 1;
+	else if (count < 0x11E)
+	{
+		*out++ = 0x1D;
+		*out++ = count - 0x1E;
+	}
+	else if (count < 0x11E + 0x10000)
+	{
+		*out++ = 0x1E;
+		*out++ = (count - 0x11E) >> 8;
+		*out++ = (count - 0x11E) & 0xFF;
+	}
+	else
+	{
+		*out++ = 0x1F;
+		*out++ = count >> 24;
+		*out++ = (count >> 16) & 0xFF;
+		*out++ = (count >> 8) & 0xFF;
+		*out++ = count & 0xFF;
+	}
+	memcpy(out, src, count);
+	return out + count;
+}
+
+unit8* PutMatch(unit8 *out, unit32 len, unit32 offset)
+{
+	offset--;
+	if (len <= 6 && offset < 8)
+		*out++ = 0x20 | offset << 2 | (len - 3);
+	else if (len <= 6)
+	{
+		*out++ = 0x80 | (len - 3) << 5 | offset >> 8;
+		*out++ = offset & 0xFF;
+	}
+	else if (len <= 38 && offset < 256)
+	{
+		*out++ = 0x40 | (len - 7);
+		*out++ = offset;
+	}
+	else
+	{
+		*out++ = 0x60 | offset >> 8;
+		*out++ = offset & 0xFF;
+		if (len <= 260)
+			*out++ = len - 7;
+		else
+		{
+			*out++ = 0xFE;
+			*out++ = (len - 0x105) >> 8;
+			*out++ = (len - 0x105) & 0xFF;
+		}
+	}
+	return out;
+}
+
+/*
+ddp_uncompress̡ϣҳÿλøƥ䣬
+ٰʵʱֽһ鶯̬滮ƥһֽڵĳͷ
+صĻɵfree
+*/
+unit8* ddp_compress(unit8 *uncompr, unit32 uncomprlen, unit32 *comprlen)
+{
+	unit32 i = 0, l = 0, skip = 0, lit = 0;
+	unit32 *price = malloc((uncomprlen + 1) * sizeof(unit32));
+	unit32 *from_len = malloc((uncomprlen + 1) * sizeof(unit32));
+	unit16 *from_off = malloc((uncomprlen + 1) * sizeof(unit16));
+	int *head = malloc(sizeof(int) << DDP_HASH_BITS);
+	int *prev = malloc((uncomprlen + 1) * sizeof(int));
+	unit8 *compr = malloc(uncomprlen + uncomprlen / 8 + 0x10), *out = compr;
+	memset(head, 0xFF, sizeof(int) << DDP_HASH_BITS);
+	memset(price, 0xFF, (uncomprlen + 1) * sizeof(unit32));
+	price[0] = 0;
+	from_len[0] = 0;
+	for (i = 0; i < uncomprlen; i++)
+	{
+		unit32 max = uncomprlen - i < DDP_MAX_MATCH ? uncomprlen - i : DDP_MAX_MATCH;
+		unit32 cost = price[i] + (from_len[i] == 1 ? 1 : 2);
+		if (cost < price[i + 1])
+		{
+			price[i + 1] = cost;
+			from_len[i + 1] = 1;
+		}
+		if (max >= 3)
+		{
+			unit32 best = 2, chain = DDP_MAX_CHAIN;
+			unit32 hash = ((uncompr[i] << 16 | uncompr[i + 1] << 8 | uncompr[i + 2]) * 2654435761U) >> (32 - DDP_HASH_BITS);
+			int cur = head[hash];
+			while (i >= skip && cur >= 0 && i - cur <= DDP_MAX_OFFSET && chain-- > 0)
+			{
+				if (uncompr[cur + best] == uncompr[i + best])
+				{
+					unit32 len = 0;
+					while (len < max && uncompr[cur + len] == uncompr[i + len])
+						len++;
+					//ԽoffsetԽԸ̵ĳǰƥ
+					for (l = best + 1; l <= len; l++)
+						if (price[i] + MatchPrice(l, i - cur) < price[i + l])
+						{
+							price[i + l] = price[i] + MatchPrice(l, i - cur);
+							from_len[i + l] = l;
+							from_off[i + l] = i - cur;
+						}
+					if (len > best)
+						best = len;
+					if (best == max)
+						break;
+				}
+				cur = prev[cur];
+			}
+			if (best >= DDP_NICE_MATCH && i + best > skip)
+				skip = i + best;
+			prev[i] = head[hash];
+			head[hash] = i;
+		}
+	}
+	//βݣÿһյprice
+	for (i = uncomprlen; i > 0; i -= from_len[i])
+		price[i - from_len[i]] = i;
+	for (i = 0; i < uncomprlen; i = price[i])
+	{
+		unit32 next = price[i];
+		if (from_len[next] == 1)
+		{
+			lit++;
+			continue;
+		}
+		if (lit)
+			out = PutLiteral(out, uncompr + i - lit, lit);
+		lit = 0;
+		out = PutMatch(out, from_len[next], from_off[next]);
+	}
+	if (lit)
+		out = PutLiteral(out, uncompr + i - lit, lit);
+	*comprlen = out - compr;
+	free(price);
+	free(from_len);
+	free(from_off);
+	free(head);
+	free(prev);
+	return compr;
+}
+
 void hxb_encrypt(unit8 *data)
 {
 	int seed = hxb_header.length[0] << 16 | hxb_header.length[1] << 8 | hxb_header.length[2];
@@ -148,6 +309,22 @@ void hxb_encrypt(unit8 *data)
 		p[i] ^= key;
 }
 
+//ѹСдѹݲcomprlenԭд벢0
+unit32 WriteData(FILE *packdst, unit8 *udata, unit32 uncomprlen)
+{
+	unit32 comprlen = 0;
+	unit8 *cdata = ddp_compress(udata, uncomprlen, &comprlen);
+	if (comprlen < uncomprlen)
+		fwrite(cdata, comprlen, 1, packdst);
+	else
+	{
+		comprlen = 0;
+		fwrite(udata, uncomprlen, 1, packdst);
+	}
+	free(cdata);
+	return comprlen;
+}
+
 void PackFile(char *fname)
 {
 	FILE *src, *dst, *packdst;
@@ -218,14 +395,13 @@ void PackFile(char *fname)
 			dst = _wfopen(FIndex[i].filename, L"rb");
 			fseek(dst, 0, SEEK_END);
 			FIndex[i].uncomprlen = ftell(dst);
-			FIndex[i].comprlen = 0;
 			FIndex[i].offset = ftell(packdst);
 			fseek(dst, 0, SEEK_SET);
 			udata = malloc(FIndex[i].uncomprlen);
 			fread(udata, FIndex[i].uncomprlen, 1, dst);
 			memcpy(&hxb_header, udata, 0x10);
 			hxb_encrypt(udata);
-			fwrite(udata, FIndex[i].uncomprlen, 1, packdst);
+			FIndex[i].comprlen = WriteData(packdst, udata, FIndex[i].uncomprlen);
 			free(udata);
 		}
 		else if (udata[0] == 'B' && udata[1] == 'M')
@@ -235,12 +411,11 @@ void PackFile(char *fname)
 			dst = _wfopen(FIndex[i].filename, L"rb");
 			fseek(dst, 0, SEEK_END);
 			FIndex[i].uncomprlen = ftell(dst);
-			FIndex[i].comprlen = 0;
 			FIndex[i].offset = ftell(packdst);
 			fseek(dst, 0, SEEK_SET);
 			udata = malloc(FIndex[i].uncomprlen);
 			fread(udata, FIndex[i].uncomprlen, 1, dst);
-			fwrite(udata, FIndex[i].uncomprlen, 1, packdst);
+			FIndex[i].comprlen = WriteData(packdst, udata, FIndex[i].uncomprlen);
 			free(udata);
 		}
 		else if (udata[0] == 0x89 && udata[1] == 0x50 && udata[2] == 0x4E && udata[3] == 0x47)
@@ -250,12 +425,11 @@ void PackFile(char *fname)
 			dst = _wfopen(FIndex[i].filename, L"rb");
 			fseek(dst, 0, SEEK_END);
 			FIndex[i].uncomprlen = ftell(dst);
-			FIndex[i].comprlen = 0;
 			FIndex[i].offset = ftell(packdst);
 			fseek(dst, 0, SEEK_SET);
 			udata = malloc(FIndex[i].uncomprlen);
 			fread(udata, FIndex[i].uncomprlen, 1, dst);
-			fwrite(udata, FIndex[i].uncomprlen, 1, packdst);
+			FIndex[i].comprlen = WriteData(packdst, udata, FIndex[i].uncomprlen);
 			free(udata);
 		}
 		else if(udata[0] == 0 && udata[1] == 0 && (udata[2] == 0x0A || udata[2] == 0x02))
@@ -265,12 +439,11 @@ void PackFile(char *fname)
 			dst = _wfopen(FIndex[i].filename, L"rb");
 			fseek(dst, 0, SEEK_END);
 			FIndex[i].uncomprlen = ftell(dst);
-			FIndex[i].comprlen = 0;
 			FIndex[i].offset = ftell(packdst);
 			fseek(dst, 0, SEEK_SET);
 			udata = malloc(FIndex[i].uncomprlen);
 			fread(udata, FIndex[i].uncomprlen, 1, dst);
-			fwrite(udata, FIndex[i].uncomprlen, 1, packdst);
+			FIndex[i].comprlen = WriteData(packdst, udata, FIndex[i].uncomprlen);
 			free(udata);
 		}
 		else
@@ -280,12 +453,11 @@ void PackFile(char *fname)
 			dst = _wfopen(FIndex[i].filename, L"rb");
 			fseek(dst, 0, SEEK_END);
 			FIndex[i].uncomprlen = ftell(dst);
-			FIndex[i].comprlen = 0;
 			FIndex[i].offset = ftell(packdst);
 			fseek(dst, 0, SEEK_SET);
 			udata = malloc(FIndex[i].uncomprlen);
 			fread(udata, FIndex[i].uncomprlen, 1, dst);
-			fwrite(udata, FIndex[i].uncomprlen, 1, packdst);
+			FIndex[i].comprlen = WriteData(packdst, udata, FIndex[i].uncomprlen);
 			free(udata);
 		}
 		fclose(dst);
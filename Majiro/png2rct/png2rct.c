@@ -0,0 +1,414 @@
+/*
+ڽpngͼƬתrct
+͸ͨʱxxx_.rc8Ϊalpha
+ֻTC00TC01rct2pngûTC01Ľݲ֣дҲ޷֤
+*/
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <io.h>
+#include <direct.h>
+#include <Windows.h>
+#include <locale.h>
+#include <png.h>
+
+typedef unsigned char  unit8;
+typedef unsigned short unit16;
+typedef unsigned int   unit32;
+
+unit32 FileNum = 0;//ļʼΪ0
+unit32 IndexCap = 0;//Indexǰʱ
+volatile LONG TaskCursor = 0;//һתļţ߳ԭӵȡ
+
+struct index
+{
+	WCHAR *FileName;//ļ
+	unit32 FileSize;//ļС
+}*Index = NULL;
+
+struct rct_header
+{
+	unit32 signature;//0x9A925A98
+	unit8 magic[4];//TC00
+	unit32 width;
+	unit32 height;
+	unit32 size;
+};
+
+struct rc8_header
+{
+	unit32 signature;//0x9A925A98
+	unit8 magic[4];//8_00
+	unit32 width;
+	unit32 height;
+	unit32 size;
+};
+
+//ÿ߳һݵĻ壬ֻͼƬ
+enum
+{
+	BUFF_PNG,//png
+	BUFF_RGB,//rctأÿ3ֽ
+	BUFF_MASK,//rc8ÿ1ֽ
+	BUFF_OUT,//ѹļ
+	BUFF_NUM
+};
+
+typedef struct rct_ctx
+{
+	unit8 *Buff[BUFF_NUM];
+	unit32 BuffSize[BUFF_NUM];
+}RCT_Ctx;
+
+unit8* GetBuff(RCT_Ctx *ctx, unit32 slot, unit32 size)
+{
+	if (ctx->BuffSize[slot] < size)
+	{
+		free(ctx->Buff[slot]);
+		ctx->Buff[slot] = malloc(size);
+		ctx->BuffSize[slot] = size;
+	}
+	return ctx->Buff[slot];
+}
+
+void FreeRCTCtx(RCT_Ctx *ctx)
+{
+	for (unit32 i = 0; i < BUFF_NUM; i++)
+		free(ctx->Buff[i]);
+	free(ctx);
+}
+
+unit32 process_dir(char *dname)
+{
+	long Handle;
+	struct _wfinddata64i32_t FileInfo;
+	_chdir(dname);//ת·
+	if ((Handle = _wfindfirst(L"*.png", &FileInfo)) == -1L)
+	{
+		printf("ûҵƥĿ뽫׺Ϊ.png\n");
+		system("pause");
+		exit(0);
+	}
+	do
+	{
+		if (FileInfo.name[0] == L'.')  //˱Ŀ¼͸Ŀ¼
+			continue;
+		if (FileNum == IndexCap)
+		{
+			IndexCap = IndexCap ? IndexCap * 2 : 0x100;
+			Index = realloc(Index, sizeof(struct index) * IndexCap);
+		}
+		Index[FileNum].FileName = _wcsdup(FileInfo.name);
+		Index[FileNum].FileSize = FileInfo.size;
+		FileNum++;
+	} while (_wfindnext(Handle, &FileInfo) == 0);
+	_findclose(Handle);
+	return FileNum;
+}
+
+//һΪÿ4ֽڵRGBAû͸ͨʱ*alphaΪFALSE
+unit8* ReadPng(RCT_Ctx *ctx, FILE *pngfile, unit32 *picwidth, unit32 *picheight, BOOL *alpha)
+{
+	png_structp png_ptr;
+	png_infop info_ptr;
+	png_bytep *rows;
+	unit32 i, width = 0, height = 0;
+	int bpp = 0, format = 0;
+	unit8 *data = NULL;
+	png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	if (png_ptr == NULL)
+	{
+		printf("PNGϢʧ!\n");
+		exit(0);
+	}
+	info_ptr = png_create_info_struct(png_ptr);
+	if (info_ptr == NULL)
+	{
+		printf("infoϢʧ!\n");
+		png_destroy_read_struct(&png_ptr, (png_infopp)NULL, (png_infopp)NULL);
+		exit(0);
+	}
+	png_init_io(png_ptr, pngfile);
+	png_read_info(png_ptr, info_ptr);
+	png_get_IHDR(png_ptr, info_ptr, (png_uint_32*)&width, (png_uint_32*)&height, &bpp, &format, NULL, NULL, NULL);
+	if (bpp != 8 || (format != PNG_COLOR_TYPE_RGB && format != PNG_COLOR_TYPE_RGB_ALPHA))
+	{
+		png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+		return NULL;
+	}
+	*alpha = format == PNG_COLOR_TYPE_RGB_ALPHA;
+	if (!*alpha)
+		png_set_filler(png_ptr, 0xFF, PNG_FILLER_AFTER);
+	data = GetBuff(ctx, BUFF_PNG, width * height * 4);
+	rows = (png_bytep*)malloc(height * sizeof(png_bytep));
+	for (i = 0; i < height; i++)
+		rows[i] = (png_bytep)(data + width * i * 4);
+	png_read_image(png_ptr, rows);
+	free(rows);
+	png_read_end(png_ptr, NULL);
+	png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+	*picwidth = width;
+	*picheight = height;
+	return data;
+}
+
+//rct_decompresspos[]32ѡλã
+void RCT_Pos(int *pos, int width)
+{
+	static const int dx[32] = { -1, -2, -3, -4, -5, -6, 3, 2, 1, 0, -1, -2, -3, 3, 2, 1, 0, -1, -2, -3, 3, 2, 1, 0, -1, -2, -3, 2, 1, 0, -1, -2 };
+	static const int dy[32] = { 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4 };
+	for (unit32 i = 0; i < 32; i++)
+		pos[i] = dx[i] - dy[i] * width;
+}
+
+//rc8_decompresspos[]16ѡλ
+void RC8_Pos(int *pos, int width)
+{
+	static const int dx[16] = { -1, -2, -3, -4, 3, 2, 1, 0, -1, -2, -3, 2, 1, 0, -1, -2 };
+	static const int dy[16] = { 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2 };
+	for (unit32 i = 0; i < 16; i++)
+		pos[i] = dx[i] - dy[i] * width;
+}
+
+//ڸѡλҳӵcurؿʼƥ䣬ֽģص
+unit32 FindMatch(unit8 *data, unit32 bpp, unit32 cur, unit32 max, int *pos, unit32 pos_num, unit32 *best_pos)
+{
+	unit32 i = 0, len = 0, best = 0;
+	unit8 *dst = data + cur * bpp, *src = NULL;
+	for (i = 0; i < pos_num; i++)
+	{
+		//ȺСʱֺѡָǰ֮ͼƬ֮ǰ
+		if (pos[i] >= 0 || (unit32)-pos[i] > cur)
+			continue;
+		src = dst + pos[i] * (int)bpp;
+		for (len = 0; len < max * bpp && src[len] == dst[len]; len++);
+		len /= bpp;
+		if (len > best)
+		{
+			best = len;
+			*best_pos = i;
+			if (best == max)
+				break;
+		}
+	}
+	return best;
+}
+
+//0x00~0x7EΪ1~127أ0x7F2ֽڳټ0x80
+unit8* PutLiteral(unit8 *out, unit8 *src, unit32 count, unit32 bpp)
+{
+	while (count)
+	{
+		unit32 n = count < 0x1007F ? count : 0x1007F;
+		if (n < 0x80)
+			*out++ = n - 1;
+		else
+		{
+			*out++ = 0x7F;
+			*out++ = (n - 0x80) & 0xFF;
+			*out++ = (n - 0x80) >> 8;
+		}
+		memcpy(out, src, n * bpp);
+		out += n * bpp;
+		src += n * bpp;
+		count -= n;
+	}
+	return out;
+}
+
+/*
+rct_decompresṣdataΪÿ3ֽڡ
+һԭţ֮ÿ32ѡλȡƥ䣬
+ƥ1~3ֻҪ1ֽڣƥãûвżΪ
+*/
+unit32 rct_compress(unit8 *data, unit32 width, unit32 height, unit8 *compr)
+{
+	unit32 count = width * height, cur = 1, lit = 0, len = 0, k = 0;
+	int pos[32];
+	unit8 *out = compr;
+	RCT_Pos(pos, width);
+	memcpy(out, data, 3);
+	out += 3;
+	while (cur < count)
+	{
+		len = FindMatch(data, 3, cur, count - cur < 0x10003 ? count - cur : 0x10003, pos, 32, &k);
+		if (len == 0)
+		{
+			lit++;
+			cur++;
+			continue;
+		}
+		if (lit)
+			out = PutLiteral(out, data + (cur - lit) * 3, lit, 3);
+		lit = 0;
+		if (len <= 3)
+			*out++ = 0x80 | k << 2 | (len - 1);
+		else
+		{
+			*out++ = 0x83 | k << 2;
+			*out++ = (len - 4) & 0xFF;
+			*out++ = (len - 4) >> 8;
+		}
+		cur += len;
+	}
+	if (lit)
+		out = PutLiteral(out, data + (cur - lit) * 3, lit, 3);
+	return out - compr;
+}
+
+//rc8_decompresṣƥ3
+unit32 rc8_compress(unit8 *data, unit32 width, unit32 height, unit8 *compr)
+{
+	unit32 count = width * height, cur = 1, lit = 0, len = 0, k = 0;
+	int pos[16];
+	unit8 *out = compr;
+	RC8_Pos(pos, width);
+	*out++ = data[0];
+	while (cur < count)
+	{
+		len = FindMatch(data, 1, cur, count - cur < 0x10009 ? count - cur : 0x10009, pos, 16, &k);
+		if (len < 3)
+		{
+			lit++;
+			cur++;
+			continue;
+		}
+		if (lit)
+			out = PutLiteral(out, data + cur - lit, lit, 1);
+		lit = 0;
+		if (len <= 9)
+			*out++ = 0x80 | k << 3 | (len - 3);
+		else
+		{
+			*out++ = 0x87 | k << 3;
+			*out++ = (len - 0xA) & 0xFF;
+			*out++ = (len - 0xA) >> 8;
+		}
+		cur += len;
+	}
+	if (lit)
+		out = PutLiteral(out, data + cur - lit, lit, 1);
+	return out - compr;
+}
+
+void SaveFile(WCHAR *fname, unit8 *data, unit32 size)
+{
+	FILE *dst = _wfopen(fname, L"wb");
+	fwrite(data, size, 1, dst);
+	fclose(dst);
+}
+
+void EncodePngFile(RCT_Ctx *ctx, WCHAR *fname)
+{
+	FILE *src = NULL;
+	unit32 i = 0, width = 0, height = 0, count = 0, rct_size = 0, rc8_size = 0;
+	unit8 *data = NULL, *rgb = NULL, *mask = NULL, *out = NULL;
+	BOOL alpha = FALSE;
+	struct rct_header RCT_Header;
+	struct rc8_header RC8_Header;
+	WCHAR dstname[MAX_PATH], basename[MAX_PATH];
+	if ((src = _wfopen(fname, L"rb")) == NULL)
+	{
+		wprintf(L"name:%ls ޷ļ\n", fname);
+		return;
+	}
+	data = ReadPng(ctx, src, &width, &height, &alpha);
+	fclose(src);
+	if (data == NULL || width == 0 || height == 0)
+	{
+		wprintf(L"name:%ls ֵ֧ͼƬͣ\n", fname);
+		return;
+	}
+	count = width * height;
+	wcscpy(basename, fname);
+	*wcsrchr(basename, L'.') = L'\0';
+	//rct2pngֱӵRGBдҲpngе˳
+	rgb = GetBuff(ctx, BUFF_RGB, count * 3);
+	for (i = 0; i < count; i++)
+		memcpy(&rgb[i * 3], &data[i * 4], 3);
+	//ÿ127ض1ֽ
+	out = GetBuff(ctx, BUFF_OUT, sizeof(struct rct_header) + 0x300 + count * 3 + count / 64 + 0x10);
+	rct_size = rct_compress(rgb, width, height, out + sizeof(struct rct_header));
+	RCT_Header.signature = 0x9A925A98;
+	memcpy(RCT_Header.magic, "TC00", 4);
+	RCT_Header.width = width;
+	RCT_Header.height = height;
+	RCT_Header.size = rct_size;
+	memcpy(out, &RCT_Header, sizeof(struct rct_header));
+	wsprintfW(dstname, L"%ls.rct", basename);
+	SaveFile(dstname, out, sizeof(struct rct_header) + rct_size);
+	if (alpha)
+	{
+		//rct2pngalphaȡɫΪҽף255-alpha
+		mask = GetBuff(ctx, BUFF_MASK, count);
+		for (i = 0; i < count; i++)
+			mask[i] = ~data[i * 4 + 3];
+		for (i = 0; i < 0x300; i++)
+			out[sizeof(struct rc8_header) + i] = i / 3;
+		rc8_size = rc8_compress(mask, width, height, out + sizeof(struct rc8_header) + 0x300);
+		RC8_Header.signature = 0x9A925A98;
+		memcpy(RC8_Header.magic, "8_00", 4);
+		RC8_Header.width = width;
+		RC8_Header.height = height;
+		RC8_Header.size = rc8_size;
+		memcpy(out, &RC8_Header, sizeof(struct rc8_header));
+		wsprintfW(dstname, L"%ls_.rc8", basename);
+		SaveFile(dstname, out, sizeof(struct rc8_header) + 0x300 + rc8_size);
+	}
+	//߳ʱһһ⻥ഩ
+	if (alpha)
+		wprintf(L"name:%ls width:%d height:%d bpp:32 rct_size:0x%X rc8_size:0x%X\n", fname, width, height, rct_size, rc8_size);
+	else
+		wprintf(L"name:%ls width:%d height:%d bpp:24 rct_size:0x%X\n", fname, width, height, rct_size);
+}
+
+DWORD WINAPI EncodeThread(LPVOID param)
+{
+	RCT_Ctx *ctx = calloc(1, sizeof(RCT_Ctx));
+	for (;;)
+	{
+		LONG n = InterlockedIncrement(&TaskCursor) - 1;
+		if ((unit32)n >= FileNum)
+			break;
+		EncodePngFile(ctx, Index[n].FileName);
+	}
+	FreeRCTCtx(ctx);
+	return 0;
+}
+
+void WriteRctFile(unit32 ThreadNum)
+{
+	if (ThreadNum == 0)
+	{
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		ThreadNum = info.dwNumberOfProcessors;
+	}
+	if (ThreadNum > MAXIMUM_WAIT_OBJECTS)
+		ThreadNum = MAXIMUM_WAIT_OBJECTS;
+	if (ThreadNum > FileNum)
+		ThreadNum = FileNum ? FileNum : 1;
+	printf("thread_num:%d\n\n", ThreadNum);
+	HANDLE *Threads = malloc(sizeof(HANDLE) * ThreadNum);
+	for (unit32 i = 0; i < ThreadNum; i++)
+		Threads[i] = CreateThread(NULL, 0, EncodeThread, NULL, 0, NULL);
+	WaitForMultipleObjects(ThreadNum, Threads, TRUE, INFINITE);
+	for (unit32 i = 0; i < ThreadNum; i++)
+		CloseHandle(Threads[i]);
+	free(Threads);
+	for (unit32 i = 0; i < FileNum; i++)
+		free(Index[i].FileName);
+	free(Index);
+}
+
+int main(int argc, char *argv[])
+{
+	setlocale(LC_ALL, "chs");
+	printf("projectNiflheim-Majiro\nڽpngͼƬתrct͸ͨʱxxx_.rc8\nļϵϡ\nѡڶָת߳ĬΪCPU\n\n");
+	process_dir(argv[1]);
+	WriteRctFile(argc > 2 ? atoi(argv[2]) : 0);
+	printf("ɣļ%d\n", FileNum);
+	system("pause");
+	return 0;
+}
\ No newline at end of file
@@ -313,12 +313,12 @@ void TC00_Export(FILE *src, wchar_t *fname)
 			free(cdata);
 			fclose(alpha);
 			alphadata = malloc(uncomprLen * 3);
-			//ɫ3ֽںһģһģûڸɶܸ߶˵
+			//ɫÿ3ֽڣһģһĻҽ
 			for (i = 0; i < uncomprLen; i++)
 			{
-				alphadata[i * 3] = rc8_alpha[rc8_data[i]];
-				alphadata[i * 3 + 1] = rc8_alpha[rc8_data[i] + 1];
-				alphadata[i * 3 + 2] = rc8_alpha[rc8_data[i] + 2];
+				alphadata[i * 3] = rc8_alpha[rc8_data[i] * 3];
+				alphadata[i * 3 + 1] = rc8_alpha[rc8_data[i] * 3 + 1];
+				alphadata[i * 3 + 2] = rc8_alpha[rc8_data[i] * 3 + 2];
 			}
 			free(rc8_data);
 			free(rc8_alpha);
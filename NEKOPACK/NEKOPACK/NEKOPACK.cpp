@@ -78,6 +78,19 @@ DWORD NEKOPACK::ParityCheck(DWORD key0, DWORD key1)
 	return v << (tmp >> 27) | v >> (32 - (tmp >> 27));
 }
 
+void NEKOPACK::BuildNameDict(DWORD seed)
+{
+	//ÿֻһhashظhashȳֵ֣ԭ˳ҵĽһ
+	dir_dict.clear();
+	file_dict.clear();
+	dir_dict.reserve(dir_names.size());
+	file_dict.reserve(file_names.size());
+	for (auto& dir_name : dir_names)
+		dir_dict.emplace(GetNameHash(seed, (char*)dir_name.c_str()), dir_name);
+	for (auto& file_name : file_names)
+		file_dict.emplace(GetNameHash(seed, (char*)file_name.c_str()), file_name);
+}
+
 bool NEKOPACK::ReadIndex(string datname)
 {
 	dirname = datname.substr(0, datname.find_last_of("."));
@@ -131,18 +144,16 @@ bool NEKOPACK::ReadIndex(string datname)
 				findexs.push_back(findex);
 			}
 			delete[] index;
+			BuildNameDict(dat_header.seed);
 			ofstream datfilename(datname + ".txt", ios::out);
 			datfilename << ";file:" + datname << endl;
 			for (auto& findex : findexs)
 			{
-				for (auto dir_name : dir_names)
+				auto dir = dir_dict.find(findex.dir_name_hash);
+				if (dir != dir_dict.end())
 				{
-					if (GetNameHash(dat_header.seed, (char*)dir_name.c_str()) == findex.dir_name_hash)
-					{
-						findex.name = dir_name;
-						datfilename << ";dirname:" + dir_name << endl;
-						break;
-					}
+					findex.name = dir->second;
+					datfilename << ";dirname:" + dir->second << endl;
 				}
 				if (findex.name.empty())
 				{
@@ -152,14 +163,11 @@ bool NEKOPACK::ReadIndex(string datname)
 				}
 				for (auto& file : findex.files)
 				{
-					for (auto file_name : file_names)
+					auto name = file_dict.find(file.file_name_hash);
+					if (name != file_dict.end())
 					{
-						if (GetNameHash(dat_header.seed, (char*)file_name.c_str()) == file.file_name_hash)
-						{
-							file.name = file_name;
-							datfilename << file_name << endl;
-							break;
-						}
+						file.name = name->second;
+						datfilename << name->second << endl;
 					}
 					if (file.name.empty())
 					{
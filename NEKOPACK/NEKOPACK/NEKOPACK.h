@@ -5,6 +5,7 @@
 #include <string> 
 #include <fstream>
 #include <map>
+#include <unordered_map>
 #include <algorithm>
 #include <Windows.h>
 #include <direct.h>
@@ -52,6 +53,7 @@ public:
 	void Encode(BYTE* buf, DWORD len, WORD* key);
 	DWORD GetNameHash(DWORD hash, char* name);
 	DWORD ParityCheck(DWORD key0, DWORD key1);
+	void BuildNameDict(DWORD seed);
 	bool ReadIndex(string datname);
 	void AddExtraName(string txt, string type);
 	void GetFiles(string name, DWORD indexsize);
@@ -66,6 +68,8 @@ private:
 	dat_header_t dat_header;
 	string dirname;
 	bool Index_OK;
+	unordered_map<DWORD, string> dir_dict;//hash->dirnameǰseedԤ
+	unordered_map<DWORD, string> file_dict;//hash->filename
 	static BYTE name_table[];
 	static vector<string> dir_names;
 	static vector<string> file_names;
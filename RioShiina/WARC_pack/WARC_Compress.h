@@ -0,0 +1,134 @@
+/*
+WARC 1.7õѹ㷨ӦWARC_unpackWARC_Decompress.hĽѹ
+*/
+#include <stdlib.h>
+#include <string.h>
+
+typedef unsigned char  unit8;
+typedef unsigned short unit16;
+typedef unsigned int   unit32;
+typedef unsigned __int64 unit64;
+
+//ռ255+256*9λݲֲÿַ8λ
+#define YH1_compressBound(len) ((len) + 0x200)
+
+struct huffman_writer {
+	unit8 *out;
+	unit64 cache;
+	unit32 curbits;//cacheлûдλ32
+};
+
+//huffman_get_bits෴32λСдһ֣дλڸλ
+void huffman_put_bits(struct huffman_writer *hw, unit32 val, unit32 bits)
+{
+	hw->cache = hw->cache << bits | val;
+	hw->curbits += bits;
+	if (hw->curbits >= 32)
+	{
+		hw->curbits -= 32;
+		*(unit32 *)hw->out = (unit32)(hw->cache >> hw->curbits);
+		hw->out += 4;
+	}
+}
+
+struct huffman_tree {
+	unit32 index;
+	unit32 left[511];
+	unit32 right[511];
+	unit64 code[256];
+	unit32 code_len[256];
+};
+
+//дڲڵΪ1ҶΪ08λַ벹01
+void huffman_write_tree(struct huffman_tree *tree, struct huffman_writer *hw, unit32 node, unit64 code, unit32 code_len)
+{
+	if (node >= 256)
+	{
+		huffman_put_bits(hw, 1, 1);
+		huffman_write_tree(tree, hw, tree->left[node], code << 1, code_len + 1);
+		huffman_write_tree(tree, hw, tree->right[node], code << 1 | 1, code_len + 1);
+	}
+	else
+	{
+		huffman_put_bits(hw, 0, 1);
+		huffman_put_bits(hw, node, 8);
+		tree->code[node] = code;
+		tree->code_len[node] = code_len;
+	}
+}
+
+/*
+Ƶʽ׼huffmanҶӰ(Ƶ,ַ)кϲȷġ
+дoutֽ4ı
+*/
+unit32 huffman_compress(unit8 *out, unit8 *in, unit32 in_len)
+{
+	struct huffman_tree tree;
+	struct huffman_writer hw;
+	unit32 freq[511], queue[511];
+	unit32 i = 0, j = 0, n = 0, head1 = 0, head2 = 0, tail2 = 0, root = 0;
+	memset(freq, 0, sizeof(freq));
+	for (i = 0; i < in_len; i++)
+		freq[in[i]]++;
+	for (i = 0; i < 256; i++)
+		if (freq[i])
+		{
+			for (j = n; j > 0 && freq[queue[j - 1]] > freq[i]; j--)
+				queue[j] = queue[j - 1];
+			queue[j] = i;
+			n++;
+		}
+	if (n == 0)
+		queue[n++] = 0;
+	//queue[0,n)ΪźҶӣqueue[n,...)Ϊɵڲڵ㣬˳ǰƵʵ
+	tree.index = 256;
+	head2 = tail2 = n;
+	for (i = 1; i < n; i++)
+	{
+		unit32 child[2];
+		for (j = 0; j < 2; j++)
+		{
+			if (head1 < n && (head2 == tail2 || freq[queue[head1]] <= freq[queue[head2]]))
+				child[j] = queue[head1++];
+			else
+				child[j] = queue[head2++];
+		}
+		tree.left[tree.index] = child[0];
+		tree.right[tree.index] = child[1];
+		freq[tree.index] = freq[child[0]] + freq[child[1]];
+		queue[tail2++] = tree.index++;
+	}
+	root = n > 1 ? queue[tail2 - 1] : queue[0];
+	hw.out = out;
+	hw.cache = 0;
+	hw.curbits = 0;
+	huffman_write_tree(&tree, &hw, root, 0, 0);
+	//ֻһַʱһҶӣݲռλ
+	if (n > 1)
+		for (i = 0; i < in_len; i++)
+		{
+			unit32 len = tree.code_len[in[i]];
+			if (len > 32)
+				huffman_put_bits(&hw, (unit32)(tree.code[in[i]] >> 32), len - 32);
+			huffman_put_bits(&hw, (unit32)tree.code[in[i]], len > 32 ? 32 : len);
+		}
+	if (hw.curbits)
+	{
+		*(unit32 *)hw.out = (unit32)(hw.cache << (32 - hw.curbits));
+		hw.out += 4;
+	}
+	return hw.out - out;
+}
+
+unit32 YH1_compress(unit8 *src, unit8 *dst, unit32 uncomprlen, unit32 sig)
+{
+	unit32 i = 0, comprlen = huffman_compress(dst, src, uncomprlen);
+	if ((sig & 0xFF000000) != 0)
+	{
+		unit32 key = 0x6393528E ^ 0x4B4D;//ɽ ^ MK
+		unit32 *enc = (unit32 *)dst;
+		for (i = 0; i < comprlen / 4; i++)
+			enc[i] ^= key;
+	}
+	return comprlen;
+}
\ No newline at end of file
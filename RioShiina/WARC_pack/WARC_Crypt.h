@@ -0,0 +1,33 @@
+#include <Windows.h>
+
+/*
+WARC 1.7ļӽģÿֻһΣ
+ֻ֮ĿĽֱܶڴĻϽ
+*/
+typedef struct warc_crypt
+{
+	unsigned int Version;//BR2.48汾,24800x9B0,SJ2.50汾0x9C4
+	unsigned int key_src[5];
+	unsigned int Seed;
+	unsigned char *RioShiinaImage;//RioShiinaͼƬ
+	unsigned int RioShiinaImageSize;
+	unsigned char *Extra;//Ķ2.50汾ʱRioShiinaImageȡkey
+	unsigned int ExtraSize;
+	unsigned char *Region;//RioShiina2.pngBGRA
+	unsigned char *ExtraImage;//2.50汾ĵͼ
+	unsigned int ExtraImageSize;
+	unsigned char *DecodeBin;//flag & 0x40000000ʱõǿ0x2000ڴ
+	char KeyString[2][MAX_PATH];//WARC_key_string0Ϊ1.20֮ǰİ汾
+	unsigned int KeyStringLen[2];
+	double Helper1[384];//decrypt_helper1(a)aΪ-128~255
+	unsigned int CrcTable[8][0x100];//crc32_getãslicing-by-8
+	unsigned int RegionCrcTable[0x100];//RegionCrc32
+}WARC_Crypt;
+
+WARC_Crypt* WarcCryptInit(void);
+void WarcCryptFree(WARC_Crypt *ctx);
+unsigned int warc_max_index_length(unsigned int WARC_version);
+void decrypt(WARC_Crypt *ctx, unsigned int WARC_version, unsigned char *cipher, unsigned int cipher_length);
+void encrypt(WARC_Crypt *ctx, unsigned int WARC_version, unsigned char *cipher, unsigned int cipher_length);
+void extra_crypt(WARC_Crypt *ctx, unsigned char *data, unsigned int length, unsigned int flags);
+void crypt2(WARC_Crypt *ctx, unsigned char *data, unsigned int length);
\ No newline at end of file
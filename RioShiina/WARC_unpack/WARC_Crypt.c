@@ -0,0 +1,746 @@
+/*
+WARC 1.7ļӽ֣ܲWARC_unpackWARC_pack
+*/
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <io.h>
+#include <math.h>
+#include <png.h>
+#include "WARC_Crypt.h"
+#define PI 3.1415926535897931
+
+typedef unsigned char  unit8;
+typedef unsigned short unit16;
+typedef unsigned int   unit32;
+
+unit32 warc_max_index_length(unit32 WARC_version)
+{
+	unit32 entry_size, max_index_entries;
+
+	if (WARC_version < 150)
+	{
+		entry_size = 0x38;//sizeof(warc_info)
+		max_index_entries = 8192;
+	}
+	else
+	{
+		entry_size = 0x38;//sizeof(warc_info)
+		max_index_entries = 16384;
+	}
+	return entry_size * max_index_entries;
+}
+
+//״̬ɵ߱棬ÿĿһ
+unit32 get_rand(unit32 *rand)
+{
+	*rand = 0x5D588B65 * *rand + 1;
+	return *rand;
+}
+
+unit32 BigEndian(unit32 u)
+{
+	return u << 24 | (u & 0xff00) << 8 | (u & 0xff0000) >> 8 | u >> 24;
+}
+
+DWORD CheckString(wchar_t *buff)
+{
+	if (wcsncmp(buff, L"0x", 2) == 0 || wcsncmp(buff, L"0X", 2) == 0)
+		return wcstoul(buff + 2, NULL, 16);
+	else
+		return wcstoul(buff, NULL, 10);
+}
+
+unit8* ReadPng(FILE* src)
+{
+	png_structp png_ptr;
+	png_infop info_ptr, end_ptr;
+	png_bytep *rows;
+	unit32 i, width = 0, height = 0, bpp = 0, format = 0;
+	unit8 buff, *Region = NULL;
+	png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	if (png_ptr == NULL)
+	{
+		printf("PNGϢʧ!\n");
+		exit(0);
+	}
+	info_ptr = png_create_info_struct(png_ptr);
+	if (info_ptr == NULL)
+	{
+		printf("infoϢʧ!\n");
+		png_destroy_read_struct(&png_ptr, (png_infopp)NULL, (png_infopp)NULL);
+		exit(0);
+	}
+	end_ptr = png_create_info_struct(png_ptr);
+	if (end_ptr == NULL)
+	{
+		printf("endϢʧ!\n");
+		png_destroy_read_struct(&png_ptr, &info_ptr, (png_infopp)NULL);
+		exit(0);
+	}
+	png_init_io(png_ptr, src);
+	png_read_info(png_ptr, info_ptr);
+	png_get_IHDR(png_ptr, info_ptr, (png_uint_32*)&width, (png_uint_32*)&height, &bpp, &format, NULL, NULL, NULL);
+	if (bpp == 8 && format == PNG_COLOR_TYPE_RGB_ALPHA)
+	{
+		Region = malloc(width * height * 4);
+		rows = (png_bytep*)malloc(height * sizeof(char*));
+		for (i = 0; i < height; i++)
+			rows[i] = (png_bytep)(Region + width*i * 4);
+		png_read_image(png_ptr, rows);
+		free(rows);
+		png_read_end(png_ptr, info_ptr);
+		png_destroy_read_struct(&png_ptr, &info_ptr, &end_ptr);
+		for (i = 0; i < height * width; i++)
+		{
+			buff = Region[i * 4];
+			Region[i * 4] = Region[i * 4 + 2];
+			Region[i * 4 + 2] = buff;
+		}
+	}
+	else
+	{
+		printf("RegionͼƬbppΪ832λRGBAͼƬϹ淶\n");
+		system("pause");
+		exit(0);
+	}
+	return Region;
+}
+
+unit8* LoadKeyFile(wchar_t *fname, unit32 *size)
+{
+	unit8 *data = NULL;
+	FILE *src = _wfopen(fname, L"rb");
+	if (src == NULL)
+		return NULL;
+	fseek(src, 0, SEEK_END);
+	*size = ftell(src);
+	data = malloc(*size);
+	fseek(src, 0, SEEK_SET);
+	fread(data, *size, 1, src);
+	fclose(src);
+	return data;
+}
+
+void Init(WARC_Crypt *ctx)
+{
+	FILE *src = NULL;
+	wchar_t filePath[MAX_PATH];
+	wchar_t dirPath[MAX_PATH];
+	wchar_t iniPath[MAX_PATH];
+	wchar_t buff[20];
+	GetCurrentDirectoryW(MAX_PATH, dirPath);
+	wsprintfW(iniPath, L"%ls\\%ls", dirPath, L"RioShiina.ini");
+	if (_waccess(iniPath, 4) == -1)
+	{
+		wprintf(L"ʼʧܣȷĿ¼ǷRioShiina.ini\n");
+		system("pause");
+		exit(0);
+	}
+	GetPrivateProfileStringW(L"RioShiina", L"Version", L"2480", buff, MAX_PATH, iniPath);
+	ctx->Version = CheckString(buff);
+	GetPrivateProfileStringW(L"RioShiina", L"Key1", L"0", buff, MAX_PATH, iniPath);
+	ctx->key_src[0] = CheckString(buff);
+	GetPrivateProfileStringW(L"RioShiina", L"Key2", L"0", buff, MAX_PATH, iniPath);
+	ctx->key_src[1] = CheckString(buff);
+	GetPrivateProfileStringW(L"RioShiina", L"Key3", L"0", buff, MAX_PATH, iniPath);
+	ctx->key_src[2] = CheckString(buff);
+	GetPrivateProfileStringW(L"RioShiina", L"Key4", L"0", buff, MAX_PATH, iniPath);
+	ctx->key_src[3] = CheckString(buff);
+	GetPrivateProfileStringW(L"RioShiina", L"Key5", L"0", buff, MAX_PATH, iniPath);
+	ctx->key_src[4] = CheckString(buff);
+	printf("Version:%d key_src:0x%X|0x%X|0x%X|0x%X|0x%X\n", ctx->Version, ctx->key_src[0], ctx->key_src[1], ctx->key_src[2], ctx->key_src[3], ctx->key_src[4]);
+	GetPrivateProfileStringW(L"Image", L"RioShiinaImage", L"", filePath, MAX_PATH, iniPath);
+	if (wcscmp(filePath, L"") == 0)
+	{
+		wprintf(L"ʼͼƬʧܣȷRioShiina.iniRioShiinaImageǷֵ\n");
+		system("pause");
+		exit(0);
+	}
+	wprintf(L"Image:%ls\n", filePath);
+	ctx->RioShiinaImage = LoadKeyFile(filePath, &ctx->RioShiinaImageSize);
+	if (ctx->RioShiinaImage == NULL)
+	{
+		wprintf(L"ʼͼƬʧܣȷĿ¼Ƿ%ls\n", filePath);
+		system("pause");
+		exit(0);
+	}
+	GetPrivateProfileStringW(L"Image", L"Region", L"", filePath, MAX_PATH, iniPath);
+	if (wcscmp(filePath, L"") == 0)
+	{
+		wprintf(L"ʼͼƬʧܣȷRioShiina.iniRegionǷֵ\n");
+		system("pause");
+		exit(0);
+	}
+	wprintf(L"Region:%ls\n\n", filePath);
+	src = _wfopen(filePath, L"rb");
+	if (src == NULL)
+	{
+		wprintf(L"ʼͼƬʧܣȷĿ¼Ƿ%ls\n", filePath);
+		system("pause");
+		exit(0);
+	}
+	ctx->Region = ReadPng(src);
+	fclose(src);
+	if (ctx->Version == 2500)
+	{
+		GetPrivateProfileStringW(L"RioShiina", L"Seed", L"0", buff, MAX_PATH, iniPath);
+		ctx->Seed = CheckString(buff);
+		wprintf(L"Seed:0x%X\n\n", ctx->Seed);
+		GetPrivateProfileStringW(L"Image", L"ExtraImage", L"", filePath, MAX_PATH, iniPath);
+		if (wcscmp(filePath, L"") == 0)
+		{
+			wprintf(L"ʼͼƬʧܣȷRioShiina.iniExtraImageǷֵ\n");
+			system("pause");
+			exit(0);
+		}
+		wprintf(L"ExtraImage:%ls\n\n", filePath);
+		ctx->ExtraImage = LoadKeyFile(filePath, &ctx->ExtraImageSize);
+		if (ctx->ExtraImage == NULL)
+		{
+			wprintf(L"ʼͼƬʧܣȷĿ¼Ƿ%ls\n", filePath);
+			system("pause");
+			exit(0);
+		}
+		GetPrivateProfileStringW(L"RioShiina", L"DecodeBin", L"", filePath, MAX_PATH, iniPath);
+		if (wcscmp(filePath, L"") == 0)
+		{
+			wprintf(L"ʼʧܣȷRioShiina.iniDecodeBinǷֵ\n");
+			system("pause");
+			exit(0);
+		}
+		wprintf(L"DecodeBin:%ls\n\n", filePath);
+		unit32 size = 0;
+		ctx->DecodeBin = LoadKeyFile(filePath, &size);
+		if (ctx->DecodeBin == NULL)
+		{
+			wprintf(L"ʼʧܣȷĿ¼Ƿ%ls\n", filePath);
+			system("pause");
+			exit(0);
+		}
+		GetPrivateProfileStringW(L"RioShiina", L"Extra", L"", filePath, MAX_PATH, iniPath);
+		if (wcscmp(filePath, L"") == 0)
+		{
+			wprintf(L"ʼʧܣȷRioShiina.iniExtraǷֵ\n");
+			system("pause");
+			exit(0);
+		}
+		wprintf(L"Extra:%ls\n\n", filePath);
+		ctx->Extra = LoadKeyFile(filePath, &ctx->ExtraSize);
+		if (ctx->Extra == NULL)
+		{
+			wprintf(L"ʼʧܣȷĿ¼Ƿ%ls\n", filePath);
+			system("pause");
+			exit(0);
+		}
+	}
+}
+
+void InitCrcTable(WARC_Crypt *ctx)
+{
+	unit32 i = 0, j = 0, k = 0;
+	//RegionCrc32õԶ
+	for (i = 0; i != 256; ++i)
+	{
+		unit32 poly = i;
+		for (j = 0; j < 8; ++j)
+		{
+			unit32 bit = poly & 1;
+			poly = (poly >> 1) | (poly << 31);
+			if (0 == bit)
+				poly ^= 0x6DB88320;
+		}
+		ctx->RegionCrcTable[i] = poly;
+	}
+	//crc32_getǸλǰCRC32CrcTable[k][b]Ϊֽbٸk0ֽʱ
+	for (i = 0; i < 256; i++)
+	{
+		unit32 crc = i << 24;
+		for (j = 0; j < 8; j++)
+			crc = (crc << 1) ^ (crc < 0x80000000 ? 0 : 0x4C11DB7);
+		ctx->CrcTable[0][i] = crc;
+	}
+	for (k = 1; k < 8; k++)
+		for (i = 0; i < 256; i++)
+			ctx->CrcTable[k][i] = (ctx->CrcTable[k - 1][i] << 8) ^ ctx->CrcTable[0][ctx->CrcTable[k - 1][i] >> 24];
+}
+
+unit32 crc32_get(WARC_Crypt *ctx, unit32 init_crc, unit8 *data, unit32 length)
+{
+	unit32 (*t)[0x100] = ctx->CrcTable;
+	unit32 result = init_crc, i = 0;
+	//ÿδ8ֽ
+	for (; i + 8 <= length; i += 8)
+	{
+		unit32 hi = result ^ (data[i] << 24 | data[i + 1] << 16 | data[i + 2] << 8 | data[i + 3]);
+		result = t[7][hi >> 24] ^ t[6][(hi >> 16) & 0xFF] ^ t[5][(hi >> 8) & 0xFF] ^ t[4][hi & 0xFF] ^
+			t[3][data[i + 4]] ^ t[2][data[i + 5]] ^ t[1][data[i + 6]] ^ t[0][data[i + 7]];
+	}
+	for (; i < length; i++)
+		result = (result << 8) ^ t[0][(result >> 24) ^ data[i]];
+	return result;
+}
+
+unit32 RegionCrc32(WARC_Crypt *ctx, unit8 *src, unit32 flags, unit32 rgb)
+{
+	unit32 *CustomCrcTable = ctx->RegionCrcTable;
+	int src_alpha = (int)flags & 0x1ff;
+	int dst_alpha = (int)(flags >> 12) & 0x1ff;
+	flags >>= 24;
+	if (0 == (flags & 0x10))
+		dst_alpha = 0;
+	if (0 == (flags & 8))
+		src_alpha = 0x100;
+	int y_step = 0;
+	int x_step = 4;
+	int width = 48;
+	int pos = 0;
+	if (0 != (flags & 0x40))//horizontal flip
+	{
+		y_step += width;
+		pos += (width - 1) * 4;
+		x_step = -x_step;
+	}
+	if (0 != (flags & 0x20))//vertical flip
+	{
+		y_step -= width;
+		pos += width * 0x2f * 4;//width*(height-1)*4;
+	}
+	y_step <<= 3;
+	unit32 checksum = 0;
+	for (int y = 0; y < 48; ++y)
+	{
+		for (int x = 0; x < 48; ++x)
+		{
+			int alpha = src[pos + 3] * src_alpha;
+			alpha >>= 8;
+			unit32 color = rgb;
+			for (int i = 0; i < 3; ++i)
+			{
+				int v = src[pos + i];
+				int c = (int)(color & 0xff);//rgb[i];
+				c -= v;
+				c = (c * dst_alpha) >> 8;
+				c = (c + v) & 0xff;
+				c = (c * alpha) >> 8;
+				checksum = (checksum >> 8) ^ CustomCrcTable[(c ^ checksum) & 0xff];
+				color >>= 8;
+			}
+			pos += x_step;
+		}
+		pos += y_step;
+	}
+	return checksum;
+}
+
+double decrypt_helper1(double a)
+{
+	if (a < 0)
+		return -decrypt_helper1(-a);
+	if (a < 18.0)
+	{
+		double v0 = a;
+		double v1 = a;
+		double v2 = -(a * a);
+
+		for (int i = 3; i < 1000; i += 2)
+		{
+			v1 *= v2 / (i * (i - 1));
+			v0 += v1 / i;
+			if (v0 == v2)
+				break;
+		}
+		return v0;
+	}
+	int flags = 0;
+	double v0_l = 0;
+	double v1 = 0;
+	double div = 1 / a;
+	double v1_h = 2.0;
+	double v0_h = 2.0;
+	double v1_l = 0;
+	double v0 = 0;
+	int i = 0;
+	do
+	{
+		v0 += div;
+		div *= ++i / a;
+		if (v0 < v0_h)
+			v0_h = v0;
+		else
+			flags |= 1;
+		v1 += div;
+		div *= ++i / a;
+		if (v1 < v1_h)
+			v1_h = v1;
+		else
+			flags |= 2;
+		v0 -= div;
+		div *= ++i / a;
+		if (v0 > v0_l)
+			v0_l = v0;
+		else
+			flags |= 4;
+		v1 -= div;
+		div *= ++i / a;
+		if (v1 > v1_l)
+			v1_l = v1;
+		else
+			flags |= 8;
+	} while (flags != 15);
+	return ((PI - cos(a) * (v0_l + v0_h)) - (sin(a) * (v1_l + v1_h))) / 2.0;
+}
+
+unit32 decrypt_helper2(unit32 *rand, unit32 WARC_version, double a)
+{
+	double v0, v1, v2, v3;
+
+	if (a > 1.0)
+	{
+		v0 = sqrt(a * 2 - 1);
+		while (1)
+		{
+			v1 = 1 - (double)get_rand(rand) / 4294967296.0;
+			v2 = 2.0 * (double)get_rand(rand) / 4294967296.0 - 1.0;
+			if (v1 * v1 + v2 * v2 > 1.0)
+				continue;
+			v2 /= v1;
+			v3 = v2 * v0 + a - 1.0;
+			if (v3 <= 0)
+				continue;
+			v1 = (a - 1.0) * log(v3 / (a - 1.0)) - v2 * v0;
+			if (v1 < -50.0)
+				continue;
+			if (((double)get_rand(rand) / 4294967296.0) <= (exp(v1) * (v2 * v2 + 1.0)))
+				break;
+		}
+	}
+	else
+	{
+		v0 = exp(1.0) / (a + exp(1.0));
+		do
+		{
+			v1 = (double)get_rand(rand) / 4294967296.0;
+			v2 = (double)get_rand(rand) / 4294967296.0;
+			if (v1 < v0)
+			{
+				v3 = pow(v2, 1.0 / a);
+				v1 = exp(-v3);
+			}
+			else
+			{
+				v3 = 1.0 - log(v2);
+				v1 = pow(v3, a - 1.0);
+			}
+		} while ((double)get_rand(rand) / 4294967296.0 >= v1);
+	}
+	if (WARC_version > 120)
+		return (unit32)(v3 * 256.0);
+	else
+		return (unit8)((double)get_rand(rand) / 4294967296.0);
+}
+
+unit32 decrypt_helper3(unit32 key)
+{
+	unit32 v0, v1, v2, v3;
+	unit8 b0, b1, b2, b3;
+	b3 = key >> 24;
+	b2 = (key & 0xFF0000) >> 16;
+	b1 = (key & 0xFF00) >> 8;
+	b0 = key & 0xFF;
+	float f;
+	f = (float)(1.5 * (double)b0 + 0.1);
+	v0 = BigEndian(*(unit32 *)&f);
+	f = (float)(1.5 * (double)b1 + 0.1);
+	v1 = (unit32)f;
+	f = (float)(1.5 * (double)b2 + 0.1);
+	v2 = (unit32)-*(int *)&f;
+	f = (float)(1.5 * (double)b3 + 0.1);
+	v3 = ~*(unit32 *)&f;
+	return (v0 + v1) | (v2 - v3);
+}
+
+void decrypt_helper4(WARC_Crypt *ctx, unit8 *data)
+{
+	unit32 code[80], key[10], i = 0;
+	unit32 k0, k1, k2, k3, k4;
+	unit32 *p = (unit32 *)(data + 44);
+	for (i = 0; i < 0x10; i++)
+		code[i] = ((p[i] & 0xFF00 | (p[i] << 16)) << 8) | (((p[i] >> 16) | p[i] & 0xFF0000) >> 8);
+	for (unit32 k = 0; k < 80 - i; ++k)
+	{
+		unit32 tmp = code[0 + k] ^ code[2 + k] ^ code[8 + k] ^ code[13 + k];
+		code[16 + k] = (tmp >> 31) | (tmp << 1);
+	}
+	memcpy(key, ctx->key_src, 4 * 5);
+	k0 = key[0];
+	k1 = key[1];
+	k2 = key[2];
+	k3 = key[3];
+	k4 = key[4];
+	for (i = 0; i < 0x50; i++)
+	{
+		unit32 f, c;
+		if (i < 0x10)
+		{
+			f = k1 ^ k2 ^ k3;
+			c = 0;
+		}
+		else if (i < 0x20)
+		{
+			f = k1 & k2 | k3 & ~k1;
+			c = 0x5A827999;
+		}
+		else if (i < 0x30)
+		{
+			f = k3 ^ (k1 | ~k2);
+			c = 0x6ED9EBA1;
+		}
+		else if (i < 0x40)
+		{
+			f = k1 & k3 | k2 & ~k3;
+			c = 0x8F1BBCDC;
+		}
+		else
+		{
+			f = k1 ^ (k2 | ~k3);
+			c = 0xA953FD4E;
+		}
+		unit32 new_k0 = code[i] + k4 + f + c + ((k0 >> 27) | (k0 << 5));
+		unit32 new_k2 = (k1 >> 2) | (k1 << 30);
+		k1 = k0;
+		k4 = k3;
+		k3 = k2;
+		k2 = new_k2;
+		k0 = new_k0;
+	}
+	key[0] += k0;
+	key[1] += k1;
+	key[2] += k2;
+	key[3] += k3;
+	key[4] += k4;
+	FILETIME ft;
+	ft.dwLowDateTime = key[1];
+	ft.dwHighDateTime = key[0] & 0x7FFFFFFF;
+	SYSTEMTIME sys_time;
+	if (!FileTimeToSystemTime(&ft, &sys_time))
+	{
+		printf("decrypt_helper4FileTimeToSystemTimeʧ!\n");
+		system("pause");
+		exit(0);
+	}
+	key[5] = (unit32)(sys_time.wYear | sys_time.wMonth << 16);
+	key[7] = (unit32)(sys_time.wHour | sys_time.wMinute << 16);
+	key[8] = (unit32)(sys_time.wSecond | sys_time.wMilliseconds << 16);
+	unit32 flags = *p | 0x80000000;
+	unit32 rgb = code[1] >> 8;
+	if ((flags & 0x78000000) == 0)
+		flags |= 0x98000000;
+	key[6] = RegionCrc32(ctx, ctx->Region, flags, rgb);
+	key[9] = (unit32)(((int)key[2] * (INT64)(int)key[3]) >> 8);
+	if (ctx->Version > 2390)
+		key[6] += key[9];
+	unit32* encoded = (unit32 *)(data + 4);
+	for (i = 0; i < 10; i++)
+		encoded[i] ^= key[i];
+}
+
+void WARC_key_string(WARC_Crypt *ctx)
+{
+	char *key = "Crypt Type %s - Copyright(C) 2000 Y.Yamada/STUDIO 悵";//褷
+
+	sprintf(ctx->KeyString[0], key, "20000823");
+	sprintf(ctx->KeyString[1], key, "20011002");
+	ctx->KeyStringLen[0] = strlen(ctx->KeyString[0]);
+	ctx->KeyStringLen[1] = strlen(ctx->KeyString[1]);
+}
+
+WARC_Crypt* WarcCryptInit(void)
+{
+	WARC_Crypt *ctx = calloc(1, sizeof(WARC_Crypt));
+	Init(ctx);
+	InitCrcTable(ctx);
+	WARC_key_string(ctx);
+	for (int a = -128; a < 256; a++)
+		ctx->Helper1[a + 128] = decrypt_helper1(a);
+	return ctx;
+}
+
+void WarcCryptFree(WARC_Crypt *ctx)
+{
+	free(ctx->RioShiinaImage);
+	free(ctx->Extra);
+	free(ctx->Region);
+	free(ctx->ExtraImage);
+	free(ctx->DecodeBin);
+	free(ctx);
+}
+
+/*
+decryptencryptõԿ֣ʼλã
+*rand*a*b*iΪֽ֮ڼӽҪõ״̬
+*/
+unit32 crypt_setup(WARC_Crypt *ctx, unit32 WARC_version, unit8 *cipher, unit32 *cipher_length, unit32 *rand, unit32 *i)
+{
+	int a, b;
+	unit32 fac = 0, idx = 0, index = 0, _cipher_length = *cipher_length, ImageSize = 0;
+	*rand = *cipher_length;
+	if (*cipher_length > 1024)
+		*cipher_length = 1024;
+	if (WARC_version > 120)
+	{
+		a = (char)cipher[0] ^ (char)_cipher_length;
+		b = (char)cipher[1] ^ (char)(_cipher_length / 2);
+		if (_cipher_length != warc_max_index_length(170))
+		{
+			//2.50汾ʱExtraͼƬ棬ƴһݿλ÷ֱȡ
+			if (ctx->Version == 2500)
+				ImageSize = ctx->RioShiinaImageSize + ctx->ExtraSize;
+			else
+				ImageSize = ctx->RioShiinaImageSize;
+			idx = (unit32)((double)get_rand(rand) * (ImageSize / 4294967296.0));
+			if (WARC_version == 130)
+				idx &= 0xff;
+			unit8 image = idx < ctx->RioShiinaImageSize ? ctx->RioShiinaImage[idx] : ctx->Extra[idx - ctx->RioShiinaImageSize];
+			if (WARC_version >= 160)
+			{
+				fac = image + *rand;
+				fac = decrypt_helper3(fac) & 0xfffffff;
+				if (*cipher_length > 0x80)
+				{
+					decrypt_helper4(ctx, cipher);
+					index += 0x80;
+					*cipher_length -= 0x80;
+				}
+			}
+			else if (WARC_version == 150)
+			{
+				fac = *rand + image;
+				fac ^= (fac & 0xfff) * (fac & 0xfff);
+				unit32 v = 0;
+				for (unit32 i = 0; i < 32; ++i)
+				{
+					unit32 bit = fac & 1;
+					fac >>= 1;
+					if (0 != bit)
+						v += fac;
+				}
+				fac = v;
+			}
+			else if (WARC_version == 140 || WARC_version == 130)
+				fac = image;
+			else
+			{
+				printf("ֵ֧WARC汾! WARC_version:%d\n", WARC_version);
+				system("pause");
+				exit(0);
+			}
+		}
+	}
+	else
+	{
+		a = cipher[0];
+		b = cipher[1];
+	}
+	*rand ^= (DWORD)(ctx->Helper1[a + 128] * 100000000.0);
+	double tmp = 0.0;
+	if (0 != (a | b))
+	{
+		tmp = acos((double)a / sqrt((double)(a*a + b*b)));
+		tmp = tmp / PI * 180.0;
+	}
+	if (b < 0)
+		tmp = 360.0 - tmp;
+	*i = ((unit8)decrypt_helper2(rand, WARC_version, tmp) + fac) % ctx->KeyStringLen[WARC_version > 120];
+	return index;
+}
+
+void decrypt(WARC_Crypt *ctx, unit32 WARC_version, unit8 *cipher, unit32 cipher_length)
+{
+	unit32 rand = 0, i = 0, n = 0, k = 0, index = 0;
+	if (cipher_length < 3)
+		return;
+	index = crypt_setup(ctx, WARC_version, cipher, &cipher_length, &rand, &i);
+	char *key_string = ctx->KeyString[WARC_version > 120];
+	unit32 key_string_len = ctx->KeyStringLen[WARC_version > 120];
+	unit8 *p = cipher + index;
+	for (k = 2; k < cipher_length; k++)
+	{
+		//(unit8)((double)rand / 16777216.0)Ǹ8λ1.20֮ǰİ汾Ϊ0
+		if (WARC_version > 120)
+			p[k] ^= get_rand(&rand) >> 24;
+		p[k] = (p[k] << 7) | (p[k] >> 1);
+		p[k] ^= key_string[n++] ^ key_string[i];
+		i = p[k] % key_string_len;
+		if (n >= key_string_len)
+			n = 0;
+	}
+}
+
+void encrypt(WARC_Crypt *ctx, unit32 WARC_version, unit8 *cipher, unit32 cipher_length)
+{
+	unit32 rand = 0, i = 0, n = 0, k = 0, index = 0;
+	if (cipher_length < 3)
+		return;
+	index = crypt_setup(ctx, WARC_version, cipher, &cipher_length, &rand, &i);
+	char *key_string = ctx->KeyString[WARC_version > 120];
+	unit32 key_string_len = ctx->KeyStringLen[WARC_version > 120];
+	unit8 *p = cipher + index;
+	for (k = 2; k < cipher_length; k++)
+	{
+		char buff = key_string[n++] ^ key_string[i];
+		i = p[k] % key_string_len;
+		p[k] ^= buff;
+		p[k] = (p[k] >> 7) | (p[k] << 1);
+		if (WARC_version > 120)
+			p[k] ^= get_rand(&rand) >> 24;
+		if (n >= key_string_len)
+			n = 0;
+	}
+}
+
+//ֻ򣬽ܼͨ
+void extra_crypt(WARC_Crypt *ctx, unit8 *data, unit32 length, unit32 flags)
+{
+	unit32 table_length = ctx->ExtraImageSize, i = 0, k = 0;
+	if (length >= 0x400)
+	{
+		if (flags == 0x202)
+		{
+			k = ctx->Seed;
+			for (i = 0; i < 0x100; i++)
+			{
+				k = 0x343FD * k + 0x269EC3;
+				data[i] ^= ctx->ExtraImage[((int)(k >> 16) & 0x7FFF) % table_length];
+			}
+		}
+		else if (flags == 0x204)
+		{
+			data[0x200] ^= (unit8)ctx->Seed;
+			data[0x201] ^= (unit8)(ctx->Seed >> 8);
+			data[0x202] ^= (unit8)(ctx->Seed >> 16);
+			data[0x203] ^= (unit8)(ctx->Seed >> 24);
+		}
+	}
+}
+
+//ͬϣܼͨ
+void crypt2(WARC_Crypt *ctx, unit8 *data, unit32 length)
+{
+	if (length >= 0x400)
+	{
+		unit32 crc = crc32_get(ctx, 0xFFFFFFFF, data, 0x100);
+		unit32 index = 0x100;
+		for (unit32 i = 0; i < 0x40; ++i)
+		{
+			unit32 src = *(unit32 *)&data[index] & 0x1FFC;
+			src = *(unit32 *)&ctx->DecodeBin[src];
+			unit32 key = src ^ crc;
+			data[index++ + 0x100] ^= (unit8)key;
+			data[index++ + 0x100] ^= (unit8)(key >> 8);
+			data[index++ + 0x100] ^= (unit8)(key >> 16);
+			data[index++ + 0x100] ^= (unit8)(key >> 24);
+		}
+	}
+}
\ No newline at end of file
@@ -17,90 +17,155 @@ made by Darkness-TX
 typedef unsigned char  unit8;
 typedef unsigned short unit16;
 typedef unsigned int   unit32;
+typedef unsigned __int64 unit64;
 
+#define HUFFMAN_TABLE_BITS 11//һλ
+#define HUFFMAN_SUB_BITS 8//볤һʱλ
+
+/*
+9λΪַڲڵ㣬4λΪһõλ
+鵽ڲڵ˵뻹û꣬Ųڸýڵϵһ
+*/
 struct huffman_state {
 	unit8 *in;
-	unit32 curbits;
-	unit32 cache;
+	unit8 *end;
+	unit64 bits;//λ
+	unit32 count;//λʣλ
 	unit32 index;
 	unit32 left[511];
 	unit32 right[511];
+	unit32 height[511];//ԸڲڵΪ߶
+	unit16 *table[511];//һڸڵ
+	unit32 table_bits[511];
+	unit16 *pool;//вһڴ
+	unit32 pool_used;
 };
 
-unit32 huffman_get_bits(struct huffman_state *hstat, DWORD req_bits)
+//ÿС˵32λӸλλ32λϣĩβ4ֽڵĲ0
+void huffman_fill(struct huffman_state *hstat)
 {
-	unit32 ret_val = 0;
-	if (req_bits > hstat->curbits)
+	while (hstat->count <= 32)
 	{
-		do
+		unit32 word = 0;
+		if (hstat->end - hstat->in >= 4)
 		{
-			req_bits -= hstat->curbits;
-			ret_val |= (hstat->cache & ((1 << hstat->curbits) - 1)) << req_bits;
-			hstat->cache = *(unit32 *)hstat->in;
+			word = *(unit32 *)hstat->in;
 			hstat->in += 4;
-			hstat->curbits = 32;
-		} while (req_bits > 32);
+		}
+		else if (hstat->in < hstat->end)
+		{
+			memcpy(&word, hstat->in, hstat->end - hstat->in);
+			hstat->in = hstat->end;
+		}
+		hstat->bits |= (unit64)word << (32 - hstat->count);
+		hstat->count += 32;
 	}
-	hstat->curbits -= req_bits;
-	return ret_val | ((1 << req_bits) - 1) & (hstat->cache >> hstat->curbits);
+}
+
+unit32 huffman_get_bits(struct huffman_state *hstat, unit32 req_bits)
+{
+	unit32 ret_val = 0;
+	huffman_fill(hstat);
+	ret_val = (unit32)(hstat->bits >> (64 - req_bits));
+	hstat->bits <<= req_bits;
+	hstat->count -= req_bits;
+	return ret_val;
+}
+
+unit32 huffman_height(struct huffman_state *hstat, unit32 node)
+{
+	return node < 256 ? 0 : hstat->height[node];
 }
 
 unit32 huffman_create_tree(struct huffman_state *hstat)
 {
-	unit32 not_leaf;
-	if (hstat->curbits-- < 1)
-	{
-		hstat->curbits = 31;
-		hstat->cache = *(unit32 *)hstat->in;
-		hstat->in += 4;
-		not_leaf = hstat->cache >> 31;
-	}
-	else
-		not_leaf = (hstat->cache >> hstat->curbits) & 1;
-	unit32 index;
-	if (not_leaf)
+	unit32 index, l = 0, r = 0;
+	if (huffman_get_bits(hstat, 1))
 	{
+		if (hstat->index >= 511)
+		{
+			printf("YH1huffmanڵ࣬ݿ𻵣\n");
+			system("pause");
+			exit(0);
+		}
 		index = hstat->index++;
 		hstat->left[index] = huffman_create_tree(hstat);
 		hstat->right[index] = huffman_create_tree(hstat);
+		l = huffman_height(hstat, hstat->left[index]);
+		r = huffman_height(hstat, hstat->right[index]);
+		hstat->height[index] = (l > r ? l : r) + 1;
 	}
 	else//ַ
 		index = huffman_get_bits(hstat, 8);
 	return index;
 }
 
+void huffman_build_table(struct huffman_state *hstat, unit32 node, unit32 max_bits);
+
+//nodedepthλ·codeչһλûҶӵģǸڲڵٽһ
+void huffman_fill_table(struct huffman_state *hstat, unit16 *tbl, unit32 bits, unit32 node, unit32 depth, unit32 code)
+{
+	if (node < 256 || depth == bits)
+	{
+		unit16 entry = (unit16)(node | depth << 12);
+		unit32 i = 0, n = 1 << (bits - depth);
+		tbl += code << (bits - depth);
+		for (i = 0; i < n; i++)
+			tbl[i] = entry;
+		if (node >= 256)
+			huffman_build_table(hstat, node, HUFFMAN_SUB_BITS);
+	}
+	else
+	{
+		huffman_fill_table(hstat, tbl, bits, hstat->left[node], depth + 1, code << 1);
+		huffman_fill_table(hstat, tbl, bits, hstat->right[node], depth + 1, code << 1 | 1);
+	}
+}
+
+//λ߶ȣСļܰðһŴ
+void huffman_build_table(struct huffman_state *hstat, unit32 node, unit32 max_bits)
+{
+	unit32 bits = hstat->height[node] < max_bits ? hstat->height[node] : max_bits;
+	hstat->table[node] = hstat->pool + hstat->pool_used;
+	hstat->table_bits[node] = bits;
+	hstat->pool_used += 1 << bits;
+	huffman_fill_table(hstat, hstat->table[node], bits, node, 0, 0);
+}
+
 void huffman_decompress(unit8 *out, unit32 out_len, unit8 *in, unit32 in_len)
 {
 	struct huffman_state hstat;
+	unit32 i = 0, root = 0;
 	hstat.in = in;
-	hstat.curbits = 0;
+	hstat.end = in + in_len;
+	hstat.bits = 0;
+	hstat.count = 0;
 	hstat.index = 256;
-	memset(hstat.left, 0, sizeof(hstat.left));
-	memset(hstat.right, 0, sizeof(hstat.right));
-	unit32 index = huffman_create_tree(&hstat);
-
-	for (unit32 i = 0; i < out_len; i++)
+	root = huffman_create_tree(&hstat);
+	if (root < 256)//ļֻһַռλ
 	{
-		unit32 idx = index;
-		while (idx >= 256)
+		memset(out, root, out_len);
+		return;
+	}
+	//һÿڲڵһһ
+	hstat.pool = malloc(sizeof(unit16) * ((1 << HUFFMAN_TABLE_BITS) + (hstat.index - 256) * (1 << HUFFMAN_SUB_BITS)));
+	hstat.pool_used = 0;
+	huffman_build_table(&hstat, root, HUFFMAN_TABLE_BITS);
+	for (i = 0; i < out_len; i++)
+	{
+		unit32 node = root, entry = 0;
+		do
 		{
-			unit32 is_right;
-			if ((int)--hstat.curbits < 0)
-			{
-				hstat.curbits = 31;
-				hstat.cache = *(unit32 *)hstat.in;
-				hstat.in += 4;
-				is_right = hstat.cache >> 31;
-			}
-			else
-				is_right = (hstat.cache >> hstat.curbits) & 1;
-			if (is_right)
-				idx = hstat.right[idx];
-			else
-				idx = hstat.left[idx];
-		}
-		*out++ = (unit8)idx;
+			if (hstat.count < HUFFMAN_TABLE_BITS)
+				huffman_fill(&hstat);
+			entry = hstat.table[node][hstat.bits >> (64 - hstat.table_bits[node])];
+			hstat.bits <<= entry >> 12;
+			hstat.count -= entry >> 12;
+			node = entry & 0x1FF;
+		} while (node >= 256);
+		out[i] = (unit8)node;
 	}
+	free(hstat.pool);
 }
 
 void YPK_decompress(unit8 *src, unit8 *dst, unit32 comprlen, unit32 uncomprlen, unit32 sig)
@@ -1,10 +1,100 @@
 #include "pgd.h"
+#include <io.h>
+
+vector<string> FileList;
+unsigned __int64 TotalSize = 0;//дתļܴСͳ
+volatile LONG TaskCursor = 0;//һתļţ߳ԭӵȡ
+volatile LONG FailNum = 0;
+
+DWORD process_dir(char *dname)
+{
+	long Handle;
+	_finddata_t FileInfo;
+	_chdir(dname);
+	if ((Handle = _findfirst("*.pgd", &FileInfo)) == -1L)
+	{
+		cout << "ûҵƥĿ뽫׺Ϊ.pgd\n";
+		system("pause");
+		exit(0);
+	}
+	do
+	{
+		//*.pgdҲᾭ8.3ļƥ䵽.PGDNֻ׺.pgd
+		char *ext = strrchr(FileInfo.name, '.');
+		if (FileInfo.attrib & _A_SUBDIR || !ext || _stricmp(ext, ".pgd"))
+			continue;
+		FileList.push_back(FileInfo.name);
+		TotalSize += FileInfo.size;
+	} while (_findnext(Handle, &FileInfo) == 0);
+	_findclose(Handle);
+	return FileList.size();
+}
+
+DWORD WINAPI ConvertThread(LPVOID param)
+{
+	pgd_buff_t buff = { 0 };
+	for (;;)
+	{
+		LONG n = InterlockedIncrement(&TaskCursor) - 1;
+		if ((DWORD)n >= FileList.size())
+			break;
+		PGD pgd(FileList[n], &buff);
+		if (pgd.pgd_uncompress())
+			printf("%s\n", FileList[n].c_str());
+		else
+		{
+			printf("%s תʧ\n", FileList[n].c_str());
+			InterlockedIncrement(&FailNum);
+		}
+	}
+	FreeBuff(&buff);
+	return 0;
+}
+
+void ConvertDir(char *dname, DWORD ThreadNum)
+{
+	DWORD FileNum = process_dir(dname);
+	//*.pgdֻƥ䵽ļ.PGDNļʱ˺һʣ
+	if (FileNum == 0)
+	{
+		cout << "ûҵƥĿ뽫׺Ϊ.pgd\n";
+		return;
+	}
+	if (ThreadNum == 0)
+	{
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		ThreadNum = info.dwNumberOfProcessors;
+	}
+	if (ThreadNum > MAXIMUM_WAIT_OBJECTS)
+		ThreadNum = MAXIMUM_WAIT_OBJECTS;
+	if (ThreadNum > FileNum)
+		ThreadNum = FileNum;
+	printf("thread_num:%d\n\n", ThreadNum);
+	DWORD start = GetTickCount();
+	HANDLE *Threads = new HANDLE[ThreadNum];
+	for (DWORD i = 0; i < ThreadNum; i++)
+		Threads[i] = CreateThread(NULL, 0, ConvertThread, NULL, 0, NULL);
+	WaitForMultipleObjects(ThreadNum, Threads, TRUE, INFINITE);
+	for (DWORD i = 0; i < ThreadNum; i++)
+		CloseHandle(Threads[i]);
+	delete[] Threads;
+	double sec = (GetTickCount() - start) / 1000.0;
+	if (sec < 0.001)
+		sec = 0.001;
+	printf("\nļ%dʧ%d%.2fMBʱ%.2f룬%.1f/룬%.2fMB/\n", FileNum, FailNum, TotalSize / 1048576.0, sec, FileNum / sec, TotalSize / 1048576.0 / sec);
+}
 
 int main(int agrc, char* agrv[])
 {
-	cout << "projectNiflheim-SOFTPAL_ADV_SYSTEM\nڽPGDļPNGʱ֧3224λѹΪ23ļ\nby Destinyλ 2016.11.13\n";
-	if (agrc != 2)
-		cout << "\nUsage:pgd2png pgdfile\n";
+	cout << "projectNiflheim-SOFTPAL_ADV_SYSTEM\nڽPGDļPNGʱ֧3224λѹΪ23ļ\nΪļʱתѡڶָ߳ĬΪCPU\nby Destinyλ 2016.11.13\n";
+	if (agrc != 2 && agrc != 3)
+		cout << "\nUsage:pgd2png pgdfile\n      pgd2png pgddir [thread_num]\n";
+	else if (GetFileAttributesA(agrv[1]) != INVALID_FILE_ATTRIBUTES && GetFileAttributesA(agrv[1]) & FILE_ATTRIBUTE_DIRECTORY)
+	{
+		ConvertDir(agrv[1], agrc == 3 ? atoi(agrv[2]) : 0);
+		system("pause");
+	}
 	else
 	{
 		PGD pgd(agrv[1]);
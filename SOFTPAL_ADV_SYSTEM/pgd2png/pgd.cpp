@@ -1,8 +1,32 @@
 #include "pgd.h"
 
-PGD::PGD(string pgdname)
+BYTE* GetBuff(pgd_buff_t *ctx, DWORD slot, DWORD size)
+{
+	if (ctx->size[slot] < size)
+	{
+		delete[] ctx->buff[slot];
+		ctx->buff[slot] = new BYTE[size];
+		ctx->size[slot] = size;
+	}
+	return ctx->buff[slot];
+}
+
+void FreeBuff(pgd_buff_t *ctx)
+{
+	for (DWORD i = 0; i < BUFF_NUM; i++)
+	{
+		delete[] ctx->buff[i];
+		ctx->buff[i] = NULL;
+		ctx->size[i] = 0;
+	}
+}
+
+PGD::PGD(string pgdname, pgd_buff_t *buff)
 {
 	filename = pgdname;
+	batch = buff != NULL;
+	memset(&own_buff, 0, sizeof(pgd_buff_t));
+	this->buff = batch ? buff : &own_buff;
 	PGD::ReadHeader(pgdname);
 }
 
@@ -13,7 +37,8 @@ bool PGD::ReadHeader(string pgdname)
 		fread(&pgd32_header, 1, sizeof(pgd32_header_t), fp);
 	else
 	{
-		cout << "ļ";
+		if (!batch)
+			cout << "ļ";
 		Header_OK = false;
 		return Header_OK;
 	}
@@ -280,57 +305,47 @@ bool PGD::pgd_uncompress()
 			if (pgd32_header.sizeof_header == 0x20)
 			{
 				fread(&pgd32_info, sizeof(pgd32_info_t), 1, fp);
-				BYTE* data = new BYTE[pgd32_info.comprlen];
+				BYTE* data = GetBuff(buff, BUFF_COMPR, pgd32_info.comprlen);
 				fread(data, 1, pgd32_info.comprlen, fp);
-				BYTE* uncompr = new BYTE[pgd32_info.uncomprlen];
+				BYTE* uncompr = GetBuff(buff, BUFF_UNCOMPR, pgd32_info.uncomprlen);
 				if (pgd32_header.compr_method == 3)
 				{
-					cout << "uncompress GE...\n";
+					if (!batch)
+						cout << "uncompress GE...\n";
 					_pgd_uncompress32(data, uncompr, pgd32_info.uncomprlen);
-					delete[] data;
 					memcpy(&ge_header, uncompr, sizeof(ge_header_t));
 					DWORD out_len = pgd32_header.width * pgd32_header.height * ge_header.bpp / 8;
-					BYTE* out = new BYTE[out_len];
-					cout << "process GE...\n";
+					BYTE* out = GetBuff(buff, BUFF_OUT, out_len);
+					if (!batch)
+						cout << "process GE...\n";
 					pgd_ge_process3(out, out_len, (BYTE*)(uncompr + sizeof(ge_header_t)), pgd32_info.uncomprlen - sizeof(ge_header_t), ge_header.width, ge_header.height, ge_header.bpp);
-					cout << "ѹ!\n";
-					delete[] uncompr;
+					if (!batch)
+						cout << "ѹ!\n";
 					if (!PGD::ge2png(out))
-					{
-						delete[] out;
 						cout << "pngʧ!\n";
-					}
 					else
-					{
-						delete[] out;
 						return true;
-					}
 				}
 				else if (pgd32_header.compr_method == 2)
 				{
-					cout << "uncompress GE...\n";
+					if (!batch)
+						cout << "uncompress GE...\n";
 					_pgd_uncompress32(data, uncompr, pgd32_info.uncomprlen);
-					delete[] data;
 					ge_header.bpp = 32;
 					ge_header.width = (WORD)pgd32_header.width;
 					ge_header.height = (WORD)pgd32_header.height;
 					ge_header.unknown = 7;
 					DWORD out_len = pgd32_header.width * pgd32_header.height * 4;
-					BYTE* out = new BYTE[out_len];
-					cout << "process GE...\n";
+					BYTE* out = GetBuff(buff, BUFF_OUT, out_len);
+					if (!batch)
+						cout << "process GE...\n";
 					pgd_ge_process2(out, out_len, uncompr, pgd32_info.uncomprlen, pgd32_header.width, pgd32_header.height);
-					cout << "ѹ!\n";
-					delete[] uncompr;
+					if (!batch)
+						cout << "ѹ!\n";
 					if (!PGD::ge2png(out))
-					{
-						delete[] out;
 						cout << "pngʧ!\n";
-					}
 					else
-					{
-						delete[] out;
 						return true;
-					}
 				}
 				else
 					cout << "23!\n";
@@ -343,7 +358,8 @@ bool PGD::pgd_uncompress()
 	}
 	else
 		cout << "ȡļͷʧ!\n";
-	system("pause");
+	if (!batch)
+		system("pause");
 	return false;
 }
 
@@ -354,7 +370,8 @@ bool PGD::ge2png(BYTE *data)
 	png_structp png_ptr;
 	png_infop info_ptr;
 	png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-	printf("width:%d height:%d bpp:%d\n", ge_header.width, ge_header.height, ge_header.bpp);
+	if (!batch)
+		printf("width:%d height:%d bpp:%d\n", ge_header.width, ge_header.height, ge_header.bpp);
 	if (png_ptr == NULL)
 	{
 		printf("PNGϢʧ!\n");
@@ -398,5 +415,7 @@ bool PGD::ge2png(BYTE *data)
 
 PGD::~PGD()
 {
-	fclose(fp);
+	if (fp)
+		fclose(fp);
+	FreeBuff(&own_buff);
 }
\ No newline at end of file
@@ -40,10 +40,28 @@ typedef struct ge_header_s
 
 #pragma pack()
 
+//תʱÿ߳һݵĻ壬ֻļ
+enum
+{
+	BUFF_COMPR,//ѹ
+	BUFF_UNCOMPR,//ѹGE
+	BUFF_OUT,//pgd_ge_process2/3
+	BUFF_NUM
+};
+
+typedef struct pgd_buff_s
+{
+	BYTE *buff[BUFF_NUM];
+	DWORD size[BUFF_NUM];
+} pgd_buff_t;
+
+BYTE* GetBuff(pgd_buff_t *ctx, DWORD slot, DWORD size);
+void FreeBuff(pgd_buff_t *ctx);
+
 class PGD
 {
 public:
-	PGD(string pgdname);
+	PGD(string pgdname, pgd_buff_t *buff = NULL);//buffΪNULLʱΪģʽϢҲͣ
 	bool pgd_uncompress();
 	bool ge2png(BYTE *out);
 	~PGD();
@@ -55,6 +73,9 @@ private:
 	void pgd_ge_process2(BYTE *out, DWORD out_len, BYTE *__ge, DWORD __ge_length, DWORD width, DWORD height);
 	void pgd_ge_process3(BYTE *out, DWORD out_len, BYTE *__ge, DWORD __ge_length, DWORD width, DWORD height, DWORD bpp);
 	FILE* fp;
+	pgd_buff_t *buff;
+	pgd_buff_t own_buff;
+	bool batch;
 	bool Header_OK;
 	string filename;
 	pgd32_header_s pgd32_header;
@@ -1,8 +1,35 @@
 #include "pgd.h"
 
-PGD::PGD(string pgdname)
+BOOL UseSSE2 = FALSE;
+
+BYTE* GetBuff(pgd_buff_t *ctx, DWORD slot, DWORD size)
+{
+	if (ctx->size[slot] < size)
+	{
+		delete[] ctx->buff[slot];
+		ctx->buff[slot] = new BYTE[size];
+		ctx->size[slot] = size;
+	}
+	return ctx->buff[slot];
+}
+
+void FreeBuff(pgd_buff_t *ctx)
+{
+	for (DWORD i = 0; i < BUFF_NUM; i++)
+	{
+		delete[] ctx->buff[i];
+		ctx->buff[i] = NULL;
+		ctx->size[i] = 0;
+	}
+}
+
+PGD::PGD(string pgdname, pgd_buff_t *buff, WORD method)
 {
 	filename = pgdname;
+	this->method = method;
+	batch = buff != NULL;
+	memset(&own_buff, 0, sizeof(pgd_buff_t));
+	this->buff = batch ? buff : &own_buff;
 	PGD::ReadHeader(pgdname);
 }
 
@@ -13,7 +40,8 @@ bool PGD::ReadHeader(string pgdname)
 		fread(&pgd32_header, 1, sizeof(pgd32_header_t), fp);
 	else
 	{
-		cout << "ļ";
+		if (!batch)
+			cout << "ļ";
 		Header_OK = false;
 		return Header_OK;
 	}
@@ -117,7 +145,8 @@ void PGD::_pgd3_ge_restore_24(BYTE *out, DWORD out_len, BYTE *__ge, DWORD __ge_l
 
 void PGD::pgd_ge_restore3(BYTE *out, DWORD out_len, BYTE *__ge, DWORD __ge_length, WORD width, WORD height, DWORD bpp)
 {
-	cout << "restore to GE...\n";
+	if (!batch)
+		cout << "restore to GE...\n";
 	if (bpp == 32)
 		_pgd3_ge_restore_32(out, out_len, __ge, __ge_length, width, height);
 	else if (bpp = 24)
@@ -126,30 +155,243 @@ void PGD::pgd_ge_restore3(BYTE *out, DWORD out_len, BYTE *__ge, DWORD __ge_lengt
 		printf("δ֪GEͣbpp:%d\n", bpp);
 }
 
-DWORD PGD::_pgd_compress32(BYTE *uncompr, DWORD uncomprlen,FILE *pgdfile)
+/*
+pgd_ge_process2̣ΪUƽ桢Vƽ(w*h/4зֽ)Yƽ(w*hֽ)
+ʱB = Y + (226U >> 7)G = Y + ((-43U - 89V) >> 7)R = Y + (179V >> 7)
+ÿ2x2BGR֮U/VٰU/VÿطƼȨСY
+ȫ16λ㣬SSE2Ľȫһ¡
+*/
+void PGD::_pgd2_encode_block(BYTE *p0, BYTE *p1, BYTE *u, BYTE *v, BYTE *y0, BYTE *y1)
+{
+	BYTE *px[4] = { p0, p0 + 4, p1, p1 + 4 };
+	BYTE *py[4] = { y0, y0 + 1, y1, y1 + 1 };
+	int sb = p0[0] + p0[4] + p1[0] + p1[4];
+	int sg = p0[1] + p0[5] + p1[1] + p1[5];
+	int sr = p0[2] + p0[6] + p1[2] + p1[6];
+	int sy = (29 * sb + 150 * sg + 77 * sr + 128) >> 8;
+	//(sb - sy) / 7.0625(sr - sy) / 5.59375
+	int cu = (((((sb - sy) << 4) * 1160) >> 16) + 1) >> 1;
+	int cv = (((((sr - sy) << 3) * 2929) >> 16) + 1) >> 1;
+	cu = cu < -128 ? -128 : cu > 127 ? 127 : cu;
+	cv = cv < -128 ? -128 : cv > 127 ? 127 : cv;
+	*u = (BYTE)cu;
+	*v = (BYTE)cv;
+	int db = (226 * cu) >> 7, dg = (-43 * cu - 89 * cv) >> 7, dr = (179 * cv) >> 7;
+	for (DWORD i = 0; i < 4; i++)
+	{
+		int y = (29 * (px[i][0] - db) + 150 * (px[i][1] - dg) + 77 * (px[i][2] - dr) + 128) >> 8;
+		*py[i] = y < 0 ? 0 : y > 255 ? 255 : y;
+	}
+}
+
+//һδи16أ8
+void PGD::_pgd2_encode_sse2(BYTE *p0, BYTE *p1, BYTE *u, BYTE *v, BYTE *y0, BYTE *y1)
+{
+	const __m128i mask = _mm_set1_epi32(0xFF);
+	const __m128i one = _mm_set1_epi16(1);
+	const __m128i c_bg = _mm_setr_epi16(29, 150, 29, 150, 29, 150, 29, 150);
+	const __m128i c_r = _mm_setr_epi16(77, 128, 77, 128, 77, 128, 77, 128);
+	__m128i b[2][2], g[2][2], r[2][2];
+	BYTE *row[2] = { p0, p1 };
+	//BGRAɸͨ816λ
+	for (DWORD i = 0; i < 2; i++)
+		for (DWORD h = 0; h < 2; h++)
+		{
+			__m128i q0 = _mm_loadu_si128((__m128i *)(row[i] + h * 32));
+			__m128i q1 = _mm_loadu_si128((__m128i *)(row[i] + h * 32 + 16));
+			b[i][h] = _mm_packs_epi32(_mm_and_si128(q0, mask), _mm_and_si128(q1, mask));
+			g[i][h] = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(q0, 8), mask), _mm_and_si128(_mm_srli_epi32(q1, 8), mask));
+			r[i][h] = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(q0, 16), mask), _mm_and_si128(_mm_srli_epi32(q1, 16), mask));
+		}
+	//4
+	__m128i sb = _mm_packs_epi32(_mm_madd_epi16(_mm_add_epi16(b[0][0], b[1][0]), one), _mm_madd_epi16(_mm_add_epi16(b[0][1], b[1][1]), one));
+	__m128i sg = _mm_packs_epi32(_mm_madd_epi16(_mm_add_epi16(g[0][0], g[1][0]), one), _mm_madd_epi16(_mm_add_epi16(g[0][1], g[1][1]), one));
+	__m128i sr = _mm_packs_epi32(_mm_madd_epi16(_mm_add_epi16(r[0][0], r[1][0]), one), _mm_madd_epi16(_mm_add_epi16(r[0][1], r[1][1]), one));
+	__m128i sy_lo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(sb, sg), c_bg), _mm_madd_epi16(_mm_unpacklo_epi16(sr, one), c_r)), 8);
+	__m128i sy_hi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(sb, sg), c_bg), _mm_madd_epi16(_mm_unpackhi_epi16(sr, one), c_r)), 8);
+	__m128i sy = _mm_packs_epi32(sy_lo, sy_hi);
+	__m128i cu = _mm_srai_epi16(_mm_add_epi16(_mm_mulhi_epi16(_mm_slli_epi16(_mm_sub_epi16(sb, sy), 4), _mm_set1_epi16(1160)), one), 1);
+	__m128i cv = _mm_srai_epi16(_mm_add_epi16(_mm_mulhi_epi16(_mm_slli_epi16(_mm_sub_epi16(sr, sy), 3), _mm_set1_epi16(2929)), one), 1);
+	cu = _mm_max_epi16(_mm_min_epi16(cu, _mm_set1_epi16(127)), _mm_set1_epi16(-128));
+	cv = _mm_max_epi16(_mm_min_epi16(cv, _mm_set1_epi16(127)), _mm_set1_epi16(-128));
+	_mm_storel_epi64((__m128i *)u, _mm_packs_epi16(cu, cu));
+	_mm_storel_epi64((__m128i *)v, _mm_packs_epi16(cv, cv));
+	__m128i db = _mm_srai_epi16(_mm_mullo_epi16(cu, _mm_set1_epi16(226)), 7);
+	__m128i dg = _mm_srai_epi16(_mm_add_epi16(_mm_mullo_epi16(cu, _mm_set1_epi16(-43)), _mm_mullo_epi16(cv, _mm_set1_epi16(-89))), 7);
+	__m128i dr = _mm_srai_epi16(_mm_mullo_epi16(cv, _mm_set1_epi16(179)), 7);
+	//ÿĲ̵ֵ
+	__m128i d[3][2] = {
+		{ _mm_unpacklo_epi16(db, db), _mm_unpackhi_epi16(db, db) },
+		{ _mm_unpacklo_epi16(dg, dg), _mm_unpackhi_epi16(dg, dg) },
+		{ _mm_unpacklo_epi16(dr, dr), _mm_unpackhi_epi16(dr, dr) }
+	};
+	BYTE *dst[2] = { y0, y1 };
+	for (DWORD i = 0; i < 2; i++)
+	{
+		__m128i y[2];
+		for (DWORD h = 0; h < 2; h++)
+		{
+			__m128i tb = _mm_sub_epi16(b[i][h], d[0][h]);
+			__m128i tg = _mm_sub_epi16(g[i][h], d[1][h]);
+			__m128i tr = _mm_sub_epi16(r[i][h], d[2][h]);
+			__m128i lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(tb, tg), c_bg), _mm_madd_epi16(_mm_unpacklo_epi16(tr, one), c_r));
+			__m128i hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(tb, tg), c_bg), _mm_madd_epi16(_mm_unpackhi_epi16(tr, one), c_r));
+			y[h] = _mm_packs_epi32(_mm_srai_epi32(lo, 8), _mm_srai_epi32(hi, 8));
+		}
+		_mm_storeu_si128((__m128i *)dst[i], _mm_packus_epi16(y[0], y[1]));
+	}
+}
+
+void PGD::pgd_ge_encode2(BYTE *out, BYTE *TexData, DWORD width, DWORD height)
+{
+	if (!batch)
+		cout << "encode GE...\n";
+	BYTE *u = out, *v = u + width * height / 4, *y = v + width * height / 4;
+	for (DWORD k = 0; k < height / 2; k++)
+	{
+		BYTE *p0 = TexData + k * 2 * width * 4, *p1 = p0 + width * 4;
+		BYTE *y0 = y + k * 2 * width, *y1 = y0 + width;
+		DWORD j = 0;
+		if (UseSSE2)
+			for (; j + 8 <= width / 2; j += 8)
+				_pgd2_encode_sse2(p0 + j * 8, p1 + j * 8, u + j, v + j, y0 + j * 2, y1 + j * 2);
+		for (; j < width / 2; j++)
+			_pgd2_encode_block(p0 + j * 8, p1 + j * 8, u + j, v + j, y0 + j * 2, y1 + j * 2);
+		u += width / 2;
+		v += width / 2;
+	}
+}
+
+//2ֻ32λҲ͸ȣ߻ż
+bool PGD::pgd_can_encode2(BYTE *TexData)
+{
+	if (ge_header.bpp != 32 || ge_header.width & 1 || ge_header.height & 1)
+		return false;
+	for (DWORD i = 0; i < (DWORD)(ge_header.width * ge_header.height); i++)
+		if (TexData[i * 4 + 3] != 0xFF)
+			return false;
+	return true;
+}
+
+void PGD::_pgd_next_flag(BYTE *&flag, DWORD &flag_count, BYTE *&out)
+{
+	//ѹʱÿ8λ̶һ־ֽڣд8tokenڵǰλԤһ
+	if (++flag_count == 8)
+	{
+		flag = out++;
+		*flag = 0;
+		flag_count = 0;
+	}
+}
+
+void PGD::_pgd_put_literal(BYTE *src, DWORD len, BYTE *&flag, DWORD &flag_count, BYTE *&out)
 {
-	cout << "build PGD...\n";
-	printf("width:%d height:%d bpp:%d\n", ge_header.width, ge_header.height, ge_header.bpp);
-	DWORD count = uncomprlen / 8;
-	DWORD yu = uncomprlen % 8;
-	BYTE zero = 0;
-	BYTE one = 1;
-	for (DWORD i = 0; i < count; i++)
+	while (len > 0)
 	{
-		fwrite(&zero, 1, 1, pgdfile);
-		for (DWORD j = 0; j < 8; j++)
+		DWORD count = len > 0xFF ? 0xFF : len;
+		*out++ = (BYTE)count;
+		memcpy(out, src, count);
+		out += count;
+		src += count;
+		len -= count;
+		_pgd_next_flag(flag, flag_count, out);
+	}
+}
+
+void PGD::_pgd_insert(BYTE *uncompr, DWORD uncomprlen, DWORD pos, int *head, int *prev)
+{
+	if (pos + PGD_MIN_MATCH > uncomprlen)
+		return;
+	DWORD hash = (*(DWORD *)&uncompr[pos] * 0x9E3779B1) >> (32 - PGD_HASH_BITS);
+	prev[pos] = head[hash];
+	head[hash] = pos;
+}
+
+DWORD PGD::_pgd_find_match(BYTE *uncompr, DWORD uncomprlen, DWORD pos, int *head, int *prev, DWORD &match)
+{
+	DWORD best = 0, chain = PGD_MAX_CHAIN;
+	DWORD max = uncomprlen - pos < PGD_MAX_MATCH ? uncomprlen - pos : PGD_MAX_MATCH;
+	if (max < PGD_MIN_MATCH)
+		return 0;
+	int cur = head[(*(DWORD *)&uncompr[pos] * 0x9E3779B1) >> (32 - PGD_HASH_BITS)];
+	while (cur >= 0 && pos - cur <= PGD_WINDOW && chain-- > 0)
+	{
+		if (uncompr[cur + best] == uncompr[pos + best])
 		{
-			fwrite(&one, 1, 1, pgdfile);
-			fwrite(&uncompr[i * 8 + j], 1, 1, pgdfile);
+			DWORD len = 0;
+			while (len < max && uncompr[cur + len] == uncompr[pos + len])
+				len++;
+			if (len > best)
+			{
+				best = len;
+				match = pos - cur;
+				if (len == max)
+					break;
+			}
 		}
+		cur = prev[cur];
 	}
-	fwrite(&zero, 1, 1, pgdfile);
-	for (DWORD k = 0; k < yu; k++)
+	return best >= PGD_MIN_MATCH ? best : 0;
+}
+
+/*
+_pgd_uncompress32̣־λӵλʼ1Ϊݣ0Ϊ
+ݣ0xFFF4~11ֽ2ֽڵĶ̸ʽ(off << 4 | 8 | len - 4)3ֽڣ2051
+1ֽڳȼ255ֽԭʼݡ
+ϣƥ䣬һλƥøʱȰѵǰֽڵ
+*/
+DWORD PGD::_pgd_compress32(BYTE *uncompr, DWORD uncomprlen, BYTE *compr)
+{
+	if (!batch)
 	{
-		fwrite(&one, 1, 1, pgdfile);
-		fwrite(&uncompr[count * 8 + k], 1, 1, pgdfile);
+		cout << "build PGD...\n";
+		printf("width:%d height:%d bpp:%d\n", ge_header.width, ge_header.height, ge_header.bpp);
 	}
-	return ftell(pgdfile) - sizeof(pgd32_header_t) - sizeof(pgd32_info_t);
+	int *head = (int *)GetBuff(buff, BUFF_HEAD, sizeof(int) << PGD_HASH_BITS);
+	int *prev = (int *)GetBuff(buff, BUFF_PREV, sizeof(int) * (uncomprlen ? uncomprlen : 1));
+	memset(head, 0xFF, sizeof(int) * (1 << PGD_HASH_BITS));
+	BYTE *out = compr, *flag = out++;
+	DWORD flag_count = 0, pos = 0, lit_start = 0;
+	*flag = 0;
+	while (pos < uncomprlen)
+	{
+		DWORD match = 0, next = 0, len = _pgd_find_match(uncompr, uncomprlen, pos, head, prev, match);
+		bool inserted = false;
+		if (len && len < PGD_MAX_MATCH && pos + 1 < uncomprlen)
+		{
+			_pgd_insert(uncompr, uncomprlen, pos, head, prev);
+			inserted = true;
+			if (_pgd_find_match(uncompr, uncomprlen, pos + 1, head, prev, next) > len)
+				len = 0;
+		}
+		if (!len)
+		{
+			if (!inserted)
+				_pgd_insert(uncompr, uncomprlen, pos, head, prev);
+			pos++;
+			continue;
+		}
+		_pgd_put_literal(uncompr + lit_start, pos - lit_start, flag, flag_count, out);
+		*flag |= 1 << flag_count;
+		if (len <= PGD_SHORT_MATCH)
+		{
+			*(WORD *)out = (WORD)((match << 4) | 8 | (len - PGD_MIN_MATCH));
+			out += 2;
+		}
+		else
+		{
+			*(WORD *)out = (WORD)((match << 4) | ((len - PGD_MIN_MATCH) >> 8));
+			out[2] = (BYTE)(len - PGD_MIN_MATCH);
+			out += 3;
+		}
+		_pgd_next_flag(flag, flag_count, out);
+		for (DWORD i = inserted ? 1 : 0; i < len; i++)
+			_pgd_insert(uncompr, uncomprlen, pos + i, head, prev);
+		pos += len;
+		lit_start = pos;
+	}
+	_pgd_put_literal(uncompr + lit_start, pos - lit_start, flag, flag_count, out);
+	return out - compr;
 }
 
 bool PGD::pgd_compress()
@@ -165,13 +407,11 @@ bool PGD::pgd_compress()
 					fread(&pgd32_info, sizeof(pgd32_info_t), 1, fp);
 					if (pgd32_header.compr_method == 3)
 					{
-						BYTE* data = new BYTE[pgd32_info.comprlen];
+						BYTE* data = GetBuff(buff, BUFF_COMPR, pgd32_info.comprlen);
 						fread(data, 1, pgd32_info.comprlen, fp);
-						BYTE* uncompr = new BYTE[pgd32_info.uncomprlen];
+						BYTE* uncompr = GetBuff(buff, BUFF_GE, pgd32_info.uncomprlen);
 						_pgd_uncompress32(data, uncompr, pgd32_info.uncomprlen);
-						delete[] data;
 						memcpy(&ge_header, uncompr, sizeof(ge_header_t));
-						delete[] uncompr;
 					}
 					else
 					{
@@ -180,27 +420,40 @@ bool PGD::pgd_compress()
 						ge_header.height = (WORD)pgd32_header.height;
 						ge_header.unknown = 7;
 						pgd32_info.uncomprlen = ge_header.width*ge_header.height * 4 + 8 + ge_header.height;
-						/*
-						pgd32_header.compr_method == 2ʱʹõ㷨Ӧһrgbת16λҶȻֲֵ㷨ġ
-						㷨һͼƬͽһΣﻹʹpgd32_header.compr_method == 3ѹ㷨
-						ԭϷѹʱһΣתٻԭֻһΣԻɡ
-						ôӣʵǷдѹ㷨Ȼȡɵķ
-						*/
-						pgd32_header.compr_method = 3;
 					}
-					BYTE *TexData = new BYTE[ge_header.height*ge_header.width*ge_header.bpp / 8];
+					BYTE *TexData = GetBuff(buff, BUFF_TEX, ge_header.height*ge_header.width*ge_header.bpp / 8);
 					if (png2raw(TexData))
 					{
-						BYTE *ge = new BYTE[pgd32_info.uncomprlen];
-						pgd_ge_restore3(ge, pgd32_info.uncomprlen, TexData, ge_header.height*ge_header.width*ge_header.bpp / 8, ge_header.width, ge_header.height, ge_header.bpp);
-						delete[] TexData;
+						/*
+						2ģԭϷѹʱѾһΣתһλģ
+						ŵĲ͸3Ҫ2~3ĬԭļͣҲǿָ
+						*/
+						WORD new_method = method ? method : pgd32_header.compr_method;
+						if (new_method == 2 && !pgd_can_encode2(TexData))
+						{
+							printf("%sżߵĲ͸32λͼ3\n", filename.c_str());
+							new_method = 3;
+						}
+						BYTE *ge = NULL;
+						if (new_method == 2)
+						{
+							pgd32_info.uncomprlen = ge_header.width * ge_header.height * 3 / 2;
+							ge = GetBuff(buff, BUFF_GE, pgd32_info.uncomprlen);
+							pgd_ge_encode2(ge, TexData, ge_header.width, ge_header.height);
+						}
+						else
+						{
+							ge = GetBuff(buff, BUFF_GE, pgd32_info.uncomprlen);
+							pgd_ge_restore3(ge, pgd32_info.uncomprlen, TexData, ge_header.height*ge_header.width*ge_header.bpp / 8, ge_header.width, ge_header.height, ge_header.bpp);
+						}
+						pgd32_header.compr_method = new_method;
+						//1ֽ̻ݽ棬ᳬԭ5/4
+						BYTE *compr = GetBuff(buff, BUFF_COMPR, pgd32_info.uncomprlen + pgd32_info.uncomprlen / 2 + 16);
+						pgd32_info.comprlen = _pgd_compress32(ge, pgd32_info.uncomprlen, compr);
 						FILE *pgdfile = fopen((filename.substr(0, filename.find_last_of(".")) + ".PGDN").c_str(), "wb");
 						fwrite(&pgd32_header, sizeof(pgd32_header_t), 1, pgdfile);
 						fwrite(&pgd32_info, sizeof(pgd32_info_t), 1, pgdfile);
-						pgd32_info.comprlen = _pgd_compress32(ge, pgd32_info.uncomprlen, pgdfile);
-						delete[] ge;
-						fseek(pgdfile, sizeof(pgd32_header_t), SEEK_SET);
-						fwrite(&pgd32_info, sizeof(pgd32_info_t), 1, pgdfile);
+						fwrite(compr, pgd32_info.comprlen, 1, pgdfile);
 						fclose(pgdfile);
 						return true;
 					}
@@ -216,7 +469,8 @@ bool PGD::pgd_compress()
 	}
 	else
 		cout << "ȡļͷʧ!\n";
-	system("pause");
+	if (!batch)
+		system("pause");
 	return false;
 }
 
@@ -228,8 +482,14 @@ bool PGD::png2raw(BYTE *TexData)
 	png_bytep *rows;
 	DWORD i = 0;
 	FILE *OpenPng = fopen((filename.substr(0, filename.find_last_of(".")) + ".png").c_str(), "rb");
+	if (OpenPng == NULL)
+	{
+		printf("ҲӦpng!\n");
+		return false;
+	}
 	png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-	cout << "restore to raw...\n";
+	if (!batch)
+		cout << "restore to raw...\n";
 	if (png_ptr == NULL)
 	{
 		printf("PNGϢʧ!\n");
@@ -283,5 +543,7 @@ bool PGD::png2raw(BYTE *TexData)
 
 PGD::~PGD()
 {
-	fclose(fp);
+	if (fp)
+		fclose(fp);
+	FreeBuff(&own_buff);
 }
\ No newline at end of file
@@ -5,9 +5,17 @@
 #include <string>
 #include <direct.h>
 #include <png.h>
+#include <emmintrin.h>
 
 using namespace std;
 
+#define PGD_WINDOW 0xFFF
+#define PGD_MIN_MATCH 4
+#define PGD_SHORT_MATCH 11
+#define PGD_MAX_MATCH 2051
+#define PGD_HASH_BITS 15
+#define PGD_MAX_CHAIN 32
+
 #pragma pack(1)
 
 typedef struct pgd32_header_s
@@ -40,21 +48,55 @@ typedef struct ge_header_s
 
 #pragma pack()
 
+//תʱÿ߳һݵĻ壬ֻļ
+enum
+{
+	BUFF_COMPR,//ԭPGDѹݣ֮Ϊµѹ
+	BUFF_GE,//ѹGEݣ֮Ϊpgd_ge_restore3/pgd_ge_encode2
+	BUFF_TEX,//png
+	BUFF_HEAD,//_pgd_compress32Ĺϣͷ
+	BUFF_PREV,//_pgd_compress32Ĺϣ
+	BUFF_NUM
+};
+
+typedef struct pgd_buff_s
+{
+	BYTE *buff[BUFF_NUM];
+	DWORD size[BUFF_NUM];
+} pgd_buff_t;
+
+BYTE* GetBuff(pgd_buff_t *ctx, DWORD slot, DWORD size);
+void FreeBuff(pgd_buff_t *ctx);
+
+extern BOOL UseSSE2;//ʱ⣬֧ʱԭ
+
 class PGD
 {
 public:
-	PGD(string pgdname);
+	PGD(string pgdname, pgd_buff_t *buff = NULL, WORD method = 0);//buffΪNULLʱΪģʽϢҲͣmethodΪ0ʱԭļѹ
 	bool pgd_compress();
 	~PGD();
 private:
 	bool png2raw(BYTE *TexData);
 	bool ReadHeader(string pgdname);
 	void _pgd_uncompress32(BYTE *compr, BYTE *uncompr, DWORD uncomprlen);
-	DWORD _pgd_compress32(BYTE *uncompr, DWORD uncomprlen, FILE *pgdfile);
+	DWORD _pgd_compress32(BYTE *uncompr, DWORD uncomprlen, BYTE *compr);
+	void _pgd_next_flag(BYTE *&flag, DWORD &flag_count, BYTE *&out);
+	void _pgd_put_literal(BYTE *src, DWORD len, BYTE *&flag, DWORD &flag_count, BYTE *&out);
+	DWORD _pgd_find_match(BYTE *uncompr, DWORD uncomprlen, DWORD pos, int *head, int *prev, DWORD &match);
+	void _pgd_insert(BYTE *uncompr, DWORD uncomprlen, DWORD pos, int *head, int *prev);
 	void _pgd3_ge_restore_24(BYTE *out, DWORD out_len, BYTE *__ge, DWORD __ge_length, WORD width, WORD height);
 	void _pgd3_ge_restore_32(BYTE *out, DWORD out_len, BYTE *__ge, DWORD __ge_length, WORD width, WORD height);
 	void pgd_ge_restore3(BYTE *out, DWORD out_len, BYTE *__ge, DWORD __ge_length, WORD width, WORD height, DWORD bpp);
+	void _pgd2_encode_block(BYTE *p0, BYTE *p1, BYTE *u, BYTE *v, BYTE *y0, BYTE *y1);
+	void _pgd2_encode_sse2(BYTE *p0, BYTE *p1, BYTE *u, BYTE *v, BYTE *y0, BYTE *y1);
+	void pgd_ge_encode2(BYTE *out, BYTE *TexData, DWORD width, DWORD height);
+	bool pgd_can_encode2(BYTE *TexData);
 	FILE* fp;
+	pgd_buff_t *buff;
+	pgd_buff_t own_buff;
+	bool batch;
+	WORD method;
 	bool Header_OK;
 	string filename;
 	pgd32_header_s pgd32_header;
@@ -11,6 +11,7 @@ made by Darkness-TX
 #include <direct.h>
 #include <Windows.h>
 #include <locale.h>
+#include "res2.h"
 
 typedef unsigned char  unit8;
 typedef unsigned short unit16;
@@ -54,83 +55,12 @@ typedef struct fileinfo
 }NodeFileInfo, *LinkFileInfo;
 LinkFileInfo FileInfo = NULL;
 
-unit32 ReadNumber(FILE *src, unit32 length_code)
-{
-	unit32 count = 0, i = 0, n = 0, rank = 0, b = 0;
-	count = (length_code & 7) + 1;
-	if (count > 4)
-	{
-		printf("count4pos:0x%X count:0x%X\n", ftell(src), count);
-		system("pause");
-		exit(0);
-	}
-	for (i = 0; i < count; ++i)
-	{
-		fread(&b, 1, 1, src);
-		n |= b << rank;
-		rank += 8;
-	}
-	if (count <= 3)
-	{
-		unit32 sign = n & (1 << (8 * count - 1));
-		if (sign != 0)
-			n -= sign << 1;
-	}
-	return n;
-}
-
-unit32 ReadInteger(FILE *src)
-{
-	unit32 opcode = 0;
-	fread(&opcode, 1, 1, src);
-	if ((opcode & 0xE0) != 0)
-	{
-		if ((opcode & 0xF8) != 0x80)
-		{
-			printf("opcodeΪ0x80pos:0x%X opcode:0x%X\n", ftell(src) - 1, opcode);
-			system("pause");
-			exit(0);
-		}
-		opcode = ReadNumber(src, opcode);
-	}
-	else
-		opcode = (opcode & 0x0F) - (opcode & 0x10);
-	return opcode;
-}
-
-void SkipObject(FILE *src)
-{
-	unit32 opcode = 0;
-	fread(&opcode, 1, 1, src);
-	if ((opcode & 0xE0) != 0)
-		ReadNumber(src, opcode);
-}
-
-void ReadString(FILE *src, char *dstname)
-{
-	unit32 opcode = 0, offset = 4, name_length = 0, savepos = 0;
-	char name_str[MAX_PATH];
-	fread(&opcode, 1, 1, src);
-	if ((opcode & 0xF8) != 0x90)
-	{
-		printf("opcode0x90pos:0x%X opcode:0x%X\n", ftell(src) - 1, opcode);
-		system("pause");
-		exit(0);
-	}
-	offset += ReadNumber(src, opcode);
-	savepos = ftell(src);
-	fseek(src, offset, SEEK_SET);
-	fread(&name_length, 4, 1, src);
-	fread(name_str, name_length, 1, src);
-	name_str[name_length] = '\0';
-	sprintf(dstname, "%s", name_str);
-	fseek(src, savepos, SEEK_SET);
-}
-
 void ReadIndex(char *fname)
 {
-	unit32 opcode_off = 0, name_count = 0, param_count = 0, arc_index = 0, i = 0, j = 0;
-	char name[MAX_PATH], type[MAX_PATH], arc_type[MAX_PATH], arc_name[MAX_PATH], param_name[MAX_PATH], *filename = NULL;
+	unit32 i = 0;
+	char *filename = NULL;
+	RES2_Info *res = NULL;
+	RES2_Entry *entry = NULL;
 	FileInfo = malloc(sizeof(NodeFileInfo));
 	FileInfo->next = NULL;
 	LinkFileInfo p = FileInfo;
@@ -138,55 +68,24 @@ void ReadIndex(char *fname)
 		filename = strrchr(fname, '\\') + 1;
 	else
 		filename = fname;
-	FILE *src = fopen("SEC5/RES2", "rb");
-	if (src == NULL)
+	res = Res2Load("SEC5/RES2");
+	for (i = 0; i < res->entry_num; i++)
 	{
-		printf("RES2򿪴SEC5ļǷRES2\n");
-		system("pause");
-		exit(0);
-	}
-	fread(&opcode_off, 4, 1, src);
-	opcode_off += 4;
-	fseek(src, opcode_off, SEEK_SET);
-	fread(&name_count, 4, 1, src);
-	for (i = 0; i < name_count; i++)
-	{
-		ReadString(src, name);
-		ReadString(src, type);
-		ReadString(src, arc_type);
-		param_count = ReadInteger(src);
-		arc_index = 0;
-		arc_name[0] = '\0';
-		for (j = 0; j < param_count; j++)
-		{
-			ReadString(src, param_name);
-			if (strncmp("path", param_name, 4) == 0)
-				ReadString(src, arc_name);
-			else if (strncmp("arc-index", param_name, 9) == 0)
-				arc_index = ReadInteger(src);
-			else if (strncmp("arc-path", param_name, 8) == 0)
-				ReadString(src, name);
-			else
-			{
-				printf("δ֪Ĳ%s offset:0x%X\n", param_name, ftell(src));
-				system("pause");
-				SkipObject(src);
-			}
-		}
-		if (strcmp(filename, arc_name) == 0)
+		entry = &res->entry[i];
+		if (strcmp(filename, entry->arc_name) == 0)
 		{
 			p->next = malloc(sizeof(NodeFileInfo));
-			if (strncmp("arc-path", param_name, 8))
-				sprintf(p->next->filename, "%s.mpg", name);
+			if (entry->arc_path[0] == '\0')
+				sprintf(p->next->filename, "%s.mpg", entry->name);
 			else
-				sprintf(p->next->filename, name + 1);//ȥб
-			p->next->index = arc_index;
+				sprintf(p->next->filename, entry->arc_path + 1);//ȥб
+			p->next->index = entry->arc_index;
 			p = p->next;
 			p->next = NULL;
-			//printf("arc_name:%s arc_index:%d arc_type:%s file_name:%s file_type:%s \n", arc_name, arc_index, arc_type, name, type);
+			//printf("arc_name:%s arc_index:%d arc_type:%s file_name:%s file_type:%s \n", entry->arc_name, entry->arc_index, entry->arc_type, entry->name, entry->type);
 		}
 	}
-	fclose(src);
+	Res2Free(res);
 }
 
 void PackFile(char *fname)
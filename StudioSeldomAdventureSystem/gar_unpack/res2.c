@@ -0,0 +1,272 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "res2.h"
+
+static void Res2Error(char *msg, unsigned int pos)
+{
+	printf("RES2%s pos:0x%X\n", msg, pos);
+	system("pause");
+	exit(0);
+}
+
+static unsigned int Res2Hash(char *name)
+{
+	unsigned int h = 0x811C9DC5;
+	while (*name)
+		h = (h ^ (unsigned char)*name++) * 0x01000193;
+	return h;
+}
+
+static int Res2ReadNumber(RES2_Info *res, unsigned int *pos, unsigned int length_code)
+{
+	unsigned int count = (length_code & 7) + 1, i = 0, n = 0;
+	if (count > 4)
+		Res2Error("count4", *pos);
+	if (*pos + count > res->size)
+		Res2Error("ݲ", *pos);
+	for (i = 0; i < count; i++)
+		n |= res->data[(*pos)++] << (i * 8);
+	if (count <= 3)
+	{
+		unsigned int sign = n & (1 << (8 * count - 1));
+		if (sign != 0)
+			n -= sign << 1;
+	}
+	return n;
+}
+
+static unsigned int Res2ReadOpcode(RES2_Info *res, unsigned int *pos)
+{
+	if (*pos >= res->size)
+		Res2Error("ݲ", *pos);
+	return res->data[(*pos)++];
+}
+
+static int Res2ReadInteger(RES2_Info *res, unsigned int *pos)
+{
+	unsigned int opcode = Res2ReadOpcode(res, pos);
+	if ((opcode & 0xE0) != 0)
+	{
+		if ((opcode & 0xF8) != 0x80)
+			Res2Error("opcodeΪ0x80", *pos - 1);
+		return Res2ReadNumber(res, pos, opcode);
+	}
+	return (opcode & 0x0F) - (opcode & 0x10);
+}
+
+static void Res2SkipObject(RES2_Info *res, unsigned int *pos)
+{
+	unsigned int opcode = Res2ReadOpcode(res, pos);
+	if ((opcode & 0xE0) != 0)
+		Res2ReadNumber(res, pos, opcode);
+}
+
+//ַoffsetΪ4ֽڳȼַŲpooloffset\0ڵַ
+static char* Res2ReadString(RES2_Info *res, unsigned int *pos)
+{
+	unsigned int opcode = Res2ReadOpcode(res, pos), offset = 0, length = 0;
+	if ((opcode & 0xF8) != 0x90)
+		Res2Error("opcode0x90", *pos - 1);
+	offset = Res2ReadNumber(res, pos, opcode);
+	if (offset > res->str_size || res->str_size - offset < 4)
+		Res2Error("ַƫƳַ", *pos);
+	length = *(unsigned int *)(res->data + 4 + offset);
+	if (length > res->str_size - offset - 4)
+		Res2Error("ַȳַ", *pos);
+	memcpy(res->pool + offset, res->data + 4 + offset + 4, length);
+	res->pool[offset + length] = '\0';
+	return res->pool + offset;
+}
+
+//opcodeĸʽдnֽȡܱʾnСֵ1~3ֽʱз
+static unsigned int Res2PutNumber(unsigned char *dst, unsigned int opcode, int n)
+{
+	unsigned int count = 1;
+	while (count < 4 && (n < -(1 << (count * 8 - 1)) || n >= (1 << (count * 8 - 1))))
+		count++;
+	dst[0] = opcode | (count - 1);
+	memcpy(dst + 1, &n, count);
+	return count + 1;
+}
+
+RES2_Info* Res2Load(char *fname)
+{
+	RES2_Info *res = NULL;
+	RES2_Entry *entry = NULL;
+	unsigned int pos = 0, i = 0, j = 0, param_count = 0;
+	char *param_name = NULL;
+	FILE *src = fopen(fname, "rb");
+	if (src == NULL)
+	{
+		printf("RES2򿪴SEC5ļǷRES2\n");
+		system("pause");
+		exit(0);
+	}
+	res = calloc(1, sizeof(RES2_Info));
+	fseek(src, 0, SEEK_END);
+	res->size = ftell(src);
+	fseek(src, 0, SEEK_SET);
+	res->data = malloc(res->size);
+	fread(res->data, res->size, 1, src);
+	fclose(src);
+	if (res->size < 8)
+		Res2Error("ļ̫С", 0);
+	res->str_size = *(unsigned int *)res->data;
+	if (res->str_size > res->size - 8)
+		Res2Error("ַСļ", 0);
+	res->pool = malloc(res->str_size + 1);
+	pos = res->str_size + 4;
+	res->entry_num = *(unsigned int *)(res->data + pos);
+	pos += 4;
+	//ÿ¼4ֽopcodeֹentry_num쳣ʱ
+	if (res->entry_num > (res->size - pos) / 4)
+		Res2Error("¼ļ", pos - 4);
+	res->entry = calloc(res->entry_num ? res->entry_num : 1, sizeof(RES2_Entry));
+	for (res->hash_mask = 1; res->hash_mask < res->entry_num * 2; res->hash_mask <<= 1);
+	res->hash = calloc(res->hash_mask, sizeof(RES2_Entry *));
+	res->hash_mask--;
+	for (i = 0; i < res->entry_num; i++)
+	{
+		entry = &res->entry[i];
+		entry->offset = pos;
+		entry->name = Res2ReadString(res, &pos);
+		entry->type = Res2ReadString(res, &pos);
+		entry->arc_type = Res2ReadString(res, &pos);
+		entry->arc_name = entry->arc_path = "";
+		param_count = Res2ReadInteger(res, &pos);
+		for (j = 0; j < param_count; j++)
+		{
+			param_name = Res2ReadString(res, &pos);
+			if (strncmp("path", param_name, 4) == 0)
+			{
+				entry->path_pos = pos;
+				entry->arc_name = Res2ReadString(res, &pos);
+				entry->path_len = pos - entry->path_pos;
+			}
+			else if (strncmp("arc-index", param_name, 9) == 0)
+			{
+				entry->index_pos = pos;
+				entry->arc_index = Res2ReadInteger(res, &pos);
+				entry->index_len = pos - entry->index_pos;
+			}
+			else if (strncmp("arc-path", param_name, 8) == 0)
+				entry->arc_path = Res2ReadString(res, &pos);
+			else
+			{
+				printf("δ֪Ĳ%s offset:0x%X\n", param_name, pos);
+				system("pause");
+				Res2SkipObject(res, &pos);
+			}
+		}
+		entry->size = pos - entry->offset;
+		//ͬ¼RES2е˳ͰRes2Findҵǰ
+		RES2_Entry **slot = &res->hash[Res2Hash(entry->name) & res->hash_mask];
+		while (*slot)
+			slot = &(*slot)->hash_next;
+		*slot = entry;
+	}
+	res->entry_end = pos;
+	return res;
+}
+
+RES2_Entry* Res2Find(RES2_Info *res, char *name)
+{
+	RES2_Entry *entry = res->hash[Res2Hash(name) & res->hash_mask];
+	while (entry && strcmp(entry->name, name))
+		entry = entry->hash_next;
+	return entry;
+}
+
+RES2_Entry* Res2FindNext(RES2_Entry *entry)
+{
+	RES2_Entry *next = entry->hash_next;
+	while (next && strcmp(next->name, entry->name))
+		next = next->hash_next;
+	return next;
+}
+
+//׷ӵַĩβдغַƫ
+unsigned int Res2AddString(RES2_Info *res, char *str)
+{
+	unsigned int length = strlen(str), offset = res->str_size + res->new_str_size;
+	if (res->new_str_size + length + 4 > res->new_str_cap)
+	{
+		res->new_str_cap = (res->new_str_size + length + 4) * 2;
+		res->new_str = realloc(res->new_str, res->new_str_cap);
+	}
+	memcpy(res->new_str + res->new_str_size, &length, 4);
+	memcpy(res->new_str + res->new_str_size + 4, str, length);
+	res->new_str_size += length + 4;
+	return offset;
+}
+
+//дʱѼ¼pathΪָpathƫƴַarc-indexΪindex
+void Res2SetArc(RES2_Entry *entry, unsigned int path, int index)
+{
+	entry->new_path = path;
+	entry->new_index = index;
+	entry->modified = TRUE;
+}
+
+//ڴƴļһдδ޸ĵļ¼ԭ
+void Res2Save(RES2_Info *res, char *fname)
+{
+	unsigned int i = 0, pos = 0, out_pos = 0, str_size = res->str_size + res->new_str_size;
+	unsigned char *out = malloc(res->size + res->new_str_size + res->entry_num * 10);
+	RES2_Entry *entry = NULL;
+	FILE *dst = NULL;
+	memcpy(out, &str_size, 4);
+	memcpy(out + 4, res->data + 4, res->str_size);
+	memcpy(out + 4 + res->str_size, res->new_str, res->new_str_size);
+	out_pos = 4 + str_size;
+	pos = 4 + res->str_size;
+	for (i = 0; i < res->entry_num; i++)
+	{
+		entry = &res->entry[i];
+		if (!entry->modified)
+			continue;
+		memcpy(out + out_pos, res->data + pos, entry->offset - pos);
+		out_pos += entry->offset - pos;
+		pos = entry->offset;
+		//patharc-indexֵȺ󲻶λ滻
+		unsigned int first = entry->path_pos, second = entry->index_pos;
+		if (first > second)
+			first = entry->index_pos, second = entry->path_pos;
+		for (unsigned int k = 0; k < 2; k++)
+		{
+			unsigned int at = k ? second : first;
+			if (at == 0)
+				continue;
+			memcpy(out + out_pos, res->data + pos, at - pos);
+			out_pos += at - pos;
+			if (at == entry->path_pos)
+			{
+				out_pos += Res2PutNumber(out + out_pos, 0x90, entry->new_path);
+				pos = at + entry->path_len;
+			}
+			else
+			{
+				out_pos += Res2PutNumber(out + out_pos, 0x80, entry->new_index);
+				pos = at + entry->index_len;
+			}
+		}
+	}
+	memcpy(out + out_pos, res->data + pos, res->size - pos);
+	out_pos += res->size - pos;
+	dst = fopen(fname, "wb");
+	fwrite(out, out_pos, 1, dst);
+	fclose(dst);
+	free(out);
+}
+
+void Res2Free(RES2_Info *res)
+{
+	free(res->data);
+	free(res->pool);
+	free(res->new_str);
+	free(res->entry);
+	free(res->hash);
+	free(res);
+}
\ No newline at end of file
@@ -14,6 +14,8 @@ made by Darkness-TX
 #include <locale.h>
 #include <time.h>
 #include <png.h>
+#include "res2.h"
+#include "iar_compress.h"
 
 typedef unsigned char  unit8;
 typedef unsigned short unit16;
@@ -31,14 +33,6 @@ struct index
 	char arc_name[MAX_PATH];//ļ
 }Index[5000];
 
-struct file_opcode
-{
-	unit8 name_opcode;
-	unit8 name_offset[4];
-	unit8 index_opcode;
-	unit8 index_num[4];
-}File_Opcode;
-
 struct iar_header {
 	unit8 magic[4];//"iar "
 	unit32 version;
@@ -50,22 +44,8 @@ struct iar_header {
 	unit32 total_num;
 }IAR_Header;
 
-struct iar_image_header {
-	unit16 flag;
-	unit8 zerobyte;
-	unit8 is_compress;//0 / 1
-	unit32 unk0;//0
-	unit32 uncomprlen;
-	unit32 palettesize;
-	unit32 comprlen;
-	unit32 unk1;//0
-	unit32 X;
-	unit32 Y;
-	unit32 width;
-	unit32 height;
-	unit32 stride;
-	unit8 bytes[0x1C];
-}IAR_Image_Header;
+struct iar_image_header IAR_Image_Header;
+struct iar_image_delta_header IAR_Image_Delta_Header;
 
 unit32 process_dir(char *dname)
 {
@@ -83,6 +63,9 @@ unit32 process_dir(char *dname)
 	{
 		if (FileInfo.name[0] == '.')  //˱Ŀ¼͸Ŀ¼
 			continue;
+		//iar_unpack -dĲ첿ԤͼҪļ
+		if (strlen(FileInfo.name) >= 10 && _stricmp(FileInfo.name + strlen(FileInfo.name) - 10, "_delta.png") == 0)
+			continue;
 		sprintf(Index[FileNum].FileName, FileInfo.name);
 		Index[FileNum].FileSize = FileInfo.size;
 		FileNum++;
@@ -118,233 +101,26 @@ void WriteRTFC(char *fname)
 	free(data);
 }
 
-unit32 ReadNumber(FILE *src, FILE *dst, unit32 length_code, BOOL open)
-{
-	unit32 count = 0, i = 0, n = 0, rank = 0, b = 0;
-	count = (length_code & 7) + 1;
-	if (count > 4)
-	{
-		printf("count4pos:0x%X count:0x%X\n", ftell(src), count);
-		system("pause");
-		exit(0);
-	}
-	for (i = 0; i < count; ++i)
-	{
-		fread(&b, 1, 1, src);
-		if (open)
-			fwrite(&b, 1, 1, dst);
-		n |= b << rank;
-		rank += 8;
-	}
-	if (count <= 3)
-	{
-		unit32 sign = n & (1 << (8 * count - 1));
-		if (sign != 0)
-		{
-			n -= sign << 1;
-			printf("off:0x%X num:0x%X old_num:0x%X\n", ftell(src) - count, n, n + (sign << 1));
-			system("pause");
-		}
-	}
-	return n;
-}
-
-unit32 ReadInteger(FILE *src, FILE *dst, BOOL open)
-{
-	unit32 opcode = 0;
-	fread(&opcode, 1, 1, src);
-	if (open)
-		fwrite(&opcode, 1, 1, dst);
-	if ((opcode & 0xE0) != 0)
-	{
-		if ((opcode & 0xF8) != 0x80)
-		{
-			printf("opcodeΪ0x80pos:0x%X opcode:0x%X\n", ftell(src) - 1, opcode);
-			system("pause");
-			exit(0);
-		}
-		opcode = ReadNumber(src, dst, opcode, open);
-	}
-	else
-		opcode = (opcode & 0x0F) - (opcode & 0x10);
-	return opcode;
-}
-
-void SkipObject(FILE *src, FILE *dst, BOOL open)
-{
-	unit32 opcode = 0;
-	fread(&opcode, 1, 1, src);
-	if (open)
-		fwrite(&opcode, 1, 1, dst);
-	if ((opcode & 0xE0) != 0)
-		ReadNumber(src, dst, opcode, open);
-}
-
-void ReadString(FILE *src, FILE *dst, char *dstname, BOOL open)
-{
-	unit32 opcode = 0, offset = 4, name_length = 0, savepos = 0;
-	char name_str[MAX_PATH];
-	fread(&opcode, 1, 1, src);
-	if (open)
-		fwrite(&opcode, 1, 1, dst);
-	if ((opcode & 0xF8) != 0x90)
-	{
-		printf("opcode0x90pos:0x%X opcode:0x%X\n", ftell(src) - 1, opcode);
-		system("pause");
-		exit(0);
-	}
-	offset += ReadNumber(src, dst, opcode, open);
-	savepos = ftell(src);
-	fseek(src, offset, SEEK_SET);
-	fread(&name_length, 4, 1, src);
-	fread(name_str, name_length, 1, src);
-	name_str[name_length] = '\0';
-	sprintf(dstname, "%s", name_str);
-	fseek(src, savepos, SEEK_SET);
-}
-
-void Build_Name_Opcode(unit32 offset)
-{
-	unit8 *p = (unit8 *)&offset;
-	File_Opcode.name_opcode = 0;
-	for (unit32 i = 0; i < 4; i++)
-	{
-		File_Opcode.name_offset[i] = p[i];
-		if (p[i] != 0)
-			File_Opcode.name_opcode++;
-	}
-	if (File_Opcode.name_opcode != 0)
-		File_Opcode.name_opcode--;
-	File_Opcode.name_opcode |= 0x90;
-}
-
-void Build_Index_Opcode(unit32 index)
-{
-	unit8 *p = (unit8 *)&index;
-	File_Opcode.index_opcode = 0;
-	for (unit32 i = 0; i < 4; i++)
-		File_Opcode.index_num[i] = p[i];
-	if (index < 0x100)
-		File_Opcode.index_opcode = 1;
-	else if (index < 0x10000)
-		File_Opcode.index_opcode = 2;
-	else if (index < 0x1000000)
-		File_Opcode.index_opcode = 3;
-	if (index >= 0x7F)
-	{
-		if (index >= 0x100)
-			File_Opcode.index_opcode--;
-		File_Opcode.index_opcode |= 0x80;
-	}
-	else
-		File_Opcode.index_opcode = 0x80;
-}
-
 void WriteRES2(char *fname)
 {
-	unit32 opcode_off = 0, name_count = 0, param_count = 0, arc_index = 0, i = 0, j = 0, k = 0, buff = 0;
-	char name[MAX_PATH], type[MAX_PATH], arc_type[MAX_PATH], arc_name[MAX_PATH], param_name[MAX_PATH];
-	unit8 *data = NULL;
-	FILE *src = fopen("SEC5/RES2", "rb");
-	if (src == NULL)
-	{
-		printf("RES2򿪴SEC5ļǷRES2\n");
-		system("pause");
-		exit(0);
-	}
-	FILE *dst = fopen("SEC5/RES2.new", "wb");
-	fread(&opcode_off, 4, 1, src);
-	data = malloc(opcode_off);
-	fread(data, opcode_off, 1, src);
-	fseek(dst, 4, SEEK_SET);
-	fwrite(data, opcode_off, 1, dst);
-	free(data);
-	Build_Name_Opcode(ftell(dst) - 4);
-	buff = strlen(fname);
-	fwrite(&buff, 4, 1, dst);
-	fwrite(fname, strlen(fname), 1, dst);
-	buff = ftell(dst) - 4;
-	fseek(dst, 0, SEEK_SET);
-	fwrite(&buff, 4, 1, dst);
-	fseek(dst, 0, SEEK_END);
-	opcode_off += 4;
-	fseek(src, opcode_off, SEEK_SET);
-	fread(&name_count, 4, 1, src);
-	fwrite(&name_count, 4, 1, dst);
-	for (i = 0; i < name_count; i++)
+	unit32 i = 0, path = 0;
+	RES2_Entry *entry = NULL;
+	RES2_Info *res = Res2Load("SEC5/RES2");
+	path = Res2AddString(res, fname);
+	//ļϣͬ¼ָ·
+	for (i = 0; i < IAR_Header.file_num; i++)
 	{
-		buff = ftell(src);
-		ReadString(src, dst, name, TRUE);
-		ReadString(src, dst, type, TRUE);
-		ReadString(src, dst, arc_type, TRUE);
-		param_count = ReadInteger(src, dst, TRUE);
-		arc_index = 0;
-		arc_name[0] = '\0';
-		for (j = 0; j < param_count; j++)
+		for (entry = Res2Find(res, Index[i].FileName); entry != NULL; entry = Res2FindNext(entry))
 		{
-			ReadString(src, dst, param_name, TRUE);
-			if (strncmp("path", param_name, 4) == 0)
-				ReadString(src, dst, arc_name, TRUE);
-			else if (strncmp("arc-index", param_name, 9) == 0)
-				arc_index = ReadInteger(src, dst, TRUE);
-			else if (strncmp("arc-path", param_name, 8) == 0)
-				SkipObject(src, dst, TRUE);
-			else
-			{
-				printf("δ֪Ĳ%s offset:0x%X\n", param_name, ftell(src));
-				system("pause");
-				SkipObject(src, dst, TRUE);
-			}
-		}
-		for (j = 0; j < IAR_Header.file_num; j++)
-		{
-			if (strcmp(name, Index[j].FileName) == 0)
-			{
-				Index[j].index = arc_index;
-				sprintf(Index[j].arc_name, "%s", arc_name);
-				Index[j].opcode_offset = buff;
-				buff = ftell(src) - buff;
-				fseek(dst, 0 - buff, SEEK_CUR);
-				Build_Index_Opcode(j);
-				fseek(src, Index[j].opcode_offset, SEEK_SET);
-				buff = ftell(dst);
-				ReadString(src, dst, name, TRUE);
-				ReadString(src, dst, type, TRUE);
-				ReadString(src, dst, arc_type, TRUE);
-				param_count = ReadInteger(src, dst, TRUE);
-				arc_index = 0;
-				arc_name[0] = '\0';
-				for (k = 0; k < param_count; k++)
-				{
-					ReadString(src, dst, param_name, TRUE);
-					if (strncmp("path", param_name, 4) == 0)
-					{
-						ReadString(src, dst, arc_name, FALSE);
-						fwrite(&File_Opcode.name_opcode, 1, 1, dst);
-						fwrite(File_Opcode.name_offset, File_Opcode.name_opcode - 0x90 + 1, 1, dst);
-					}
-					else if (strncmp("arc-index", param_name, 9) == 0)
-					{
-						arc_index = ReadInteger(src, dst, FALSE);
-						fwrite(&File_Opcode.index_opcode, 1, 1, dst);
-						fwrite(File_Opcode.index_num, File_Opcode.index_opcode - 0x80 + 1, 1, dst);
-					}
-					else if (strncmp("arc-path", param_name, 8) == 0)
-						SkipObject(src, dst, TRUE);
-					else
-					{
-						printf("δ֪Ĳ%s offset:0x%X\n", param_name, ftell(src));
-						system("pause");
-						SkipObject(src, dst, TRUE);
-					}
-				}
-				printf("arc_name:%s arc_index:%d arc_type:%s file_name:%s file_type:%s op_offset:0x%X\n", fname, i, arc_type, name, type, buff);
-				break;
-			}
+			Index[i].index = entry->arc_index;
+			sprintf(Index[i].arc_name, "%s", entry->arc_name);
+			Index[i].opcode_offset = entry->offset;
+			Res2SetArc(entry, path, i);
+			printf("arc_name:%s arc_index:%d arc_type:%s file_name:%s file_type:%s op_offset:0x%X\n", fname, i, entry->arc_type, entry->name, entry->type, entry->offset);
 		}
 	}
-	fclose(src);
-	fclose(dst);
+	Res2Save(res, "SEC5/RES2.new");
+	Res2Free(res);
 }
 
 void BuildHeader()
@@ -444,6 +220,7 @@ unit8* ReadPng(FILE *pngfile, char* filename)
 			bitmapdata[i * 4 + 2] = buff;
 		}
 		dst_data = malloc(IAR_Image_Header.uncomprlen);
+		memset(dst_data, 0, IAR_Image_Header.uncomprlen);
 		for (i = 0; i < IAR_Image_Header.height; i++)
 			memcpy(&dst_data[i * IAR_Image_Header.stride], &bitmapdata[i * IAR_Image_Header.width * 4], IAR_Image_Header.width * 4);
 		free(bitmapdata);
@@ -477,6 +254,7 @@ unit8* ReadPng(FILE *pngfile, char* filename)
 			bitmapdata[i * 3 + 2] = buff;
 		}
 		dst_data = malloc(IAR_Image_Header.uncomprlen);
+		memset(dst_data, 0, IAR_Image_Header.uncomprlen);
 		for (i = 0; i < IAR_Image_Header.height; i++)
 			memcpy(&dst_data[i * IAR_Image_Header.stride], &bitmapdata[i * IAR_Image_Header.width * 3], IAR_Image_Header.width * 3);
 		free(bitmapdata);
@@ -502,7 +280,7 @@ void PackFile(char *fname)
 	FILE *src = NULL, *dst = NULL, *fp = NULL;
 	unit32 i = 0;
 	unit64 offset = 0;
-	unit8 *data = NULL;
+	unit8 *data = NULL, *cdata = NULL;
 	sprintf(dstname, "%s.iar", fname);
 	dst = fopen(dstname, "wb");
 	fwrite(&IAR_Header, sizeof(IAR_Header), 1, dst);
@@ -520,26 +298,55 @@ void PackFile(char *fname)
 		fread(&offset, 8, 1, fp);
 		_fseeki64(fp, offset, SEEK_SET);
 		fread(&IAR_Image_Header, sizeof(IAR_Image_Header), 1, fp);
-		IAR_Image_Header.is_compress = 0;
 		fclose(fp);
 		_chdir(fname);
 		offset = _ftelli64(dst);
 		Index[i].FileName[strlen(Index[i].FileName)] = '.';
 		src = fopen(Index[i].FileName, "rb");
 		data = ReadPng(src, Index[i].FileName);
-		if (IAR_Image_Header.flag == 0x3C)
+		if (IAR_Image_Header.flag == 0x3C || IAR_Image_Header.flag == 0x1C)
+		{
+			unit64 *row_hash = HashRows(&IAR_Image_Header, data);
+			unit32 delta_len = 0;
+			unit8 *delta = BuildDelta(&IAR_Image_Header, &IAR_Image_Delta_Header, data, row_hash, &delta_len);
+			if (delta)
+			{
+				IAR_Image_Header.flag |= 0x800;
+				IAR_Image_Header.uncomprlen = delta_len;
+				free(data);
+				free(row_hash);
+				data = delta;
+			}
+			else
+				AddBase(i, &IAR_Image_Header, data, row_hash);
+		}
+		cdata = iar_compress(data, IAR_Image_Header.uncomprlen, &IAR_Image_Header.comprlen);
+		IAR_Image_Header.is_compress = 1;
+		if (IAR_Image_Header.comprlen >= IAR_Image_Header.uncomprlen)//ѹľԭ
+		{
+			free(cdata);
+			cdata = data;
+			data = NULL;
+			IAR_Image_Header.is_compress = 0;
+			IAR_Image_Header.comprlen = IAR_Image_Header.uncomprlen;
+		}
+		if ((IAR_Image_Header.flag & 0xFF) == 0x3C)
 			printf("\t%s offset:0x%llX stride:0x%X width:%d height:%d bpp:32 flag:0x%X uncomprlen:0x%X comprlen:0x%X\n", Index[i].FileName, offset, IAR_Image_Header.stride, IAR_Image_Header.width, IAR_Image_Header.height, IAR_Image_Header.flag, IAR_Image_Header.uncomprlen, IAR_Image_Header.comprlen);
 		else
 			printf("\t%s offset:0x%llX stride:0x%X width:%d height:%d bpp:24 flag:0x%X uncomprlen:0x%X comprlen:0x%X\n", Index[i].FileName, offset, IAR_Image_Header.stride, IAR_Image_Header.width, IAR_Image_Header.height, IAR_Image_Header.flag, IAR_Image_Header.uncomprlen, IAR_Image_Header.comprlen);
+		if (IAR_Image_Header.flag & 0x800)
+			printf("\t\tbase:%d start_line:%d lines:%d\n", IAR_Image_Delta_Header.base_image_id, IAR_Image_Delta_Header.start_line, IAR_Image_Delta_Header.lines);
 		fclose(src);
 		fwrite(&IAR_Image_Header, sizeof(IAR_Image_Header), 1, dst);
-		fwrite(data, IAR_Image_Header.comprlen, 1, dst);
+		fwrite(cdata, IAR_Image_Header.comprlen, 1, dst);
+		free(cdata);
 		free(data);
 		fseek(dst, i * 8 + sizeof(IAR_Header), SEEK_SET);
 		fwrite(&offset, 8, 1, dst);
 		fseek(dst, 0, SEEK_END);
 		_chdir("..");
 	}
+	FreeBases();
 }
 
 int main(int argc, char *argv[])
@@ -0,0 +1,37 @@
+#include <Windows.h>
+
+typedef unsigned char  unit8;
+typedef unsigned short unit16;
+typedef unsigned int   unit32;
+typedef unsigned __int64 unit64;
+
+struct iar_image_header {
+	unit16 flag;
+	unit8 zerobyte;
+	unit8 is_compress;//0 / 1
+	unit32 unk0;//0
+	unit32 uncomprlen;
+	unit32 palettesize;
+	unit32 comprlen;
+	unit32 unk1;//0
+	unit32 X;
+	unit32 Y;
+	unit32 width;
+	unit32 height;
+	unit32 stride;
+	unit8 bytes[0x1C];
+};
+
+struct iar_image_delta_header {
+	unit32 base_image_id;
+	unit32 start_line;
+	unit32 lines;
+};
+
+//iar_uncompressĸʽѹصĻɵfree
+unit8* iar_compress(unit8 *uncompr, unit32 uncomprlen, unit32 *comprlen);
+//֡HashRowsBuildDelta׼ͼɲݣòʱͼAddBaseԺĻ׼ͼ
+unit64* HashRows(struct iar_image_header *hdr, unit8 *data);
+void AddBase(unit32 index, struct iar_image_header *hdr, unit8 *data, unit64 *row_hash);
+void FreeBases();
+unit8* BuildDelta(struct iar_image_header *hdr, struct iar_image_delta_header *delta_hdr, unit8 *data, unit64 *row_hash, unit32 *len);
\ No newline at end of file
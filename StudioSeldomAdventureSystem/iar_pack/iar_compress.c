@@ -0,0 +1,393 @@
+#include <stdlib.h>
+#include <string.h>
+#include "iar_compress.h"
+
+#define IAR_MAX_OFFSET 8192
+#define IAR_MAX_MATCH 272
+#define IAR_NICE_MATCH 64//ҵôƥֱӲãмλõ
+#define IAR_HASH_BITS 16
+#define IAR_MAX_CHAIN 48
+
+typedef struct iar_bit_writer
+{
+	unit8 *out;//һֽдλ
+	unit8 *flag;//ǰ־ֵλ
+	unit32 bits;//ǰ־õλ
+}IAR_Bit_Writer;
+
+static void PutBit(IAR_Bit_Writer *bw, unit32 bit)
+{
+	//ѹʱ16λҪһλʱȡµı־֣ҲҪдһλʱԤ
+	if (bw->bits == 16)
+	{
+		bw->flag = bw->out;
+		bw->out += 2;
+		bw->flag[0] = bw->flag[1] = 0;
+		bw->bits = 0;
+	}
+	if (bit)
+		bw->flag[bw->bits >> 3] |= 1 << (bw->bits & 7);
+	bw->bits++;
+}
+
+//offsetֶΣ1~512513~10241025~20482049~40964097~8192
+static unit32 OffsetClass(unit32 offset)
+{
+	return offset <= 512 ? 0 : offset <= 1024 ? 1 : offset <= 2048 ? 2 : offset <= 4096 ? 3 : 4;
+}
+
+//iar_uncompressıһƥҪõλŽ
+static unit32 MatchPrice(unit32 len, unit32 offset)
+{
+	static const unit32 offset_bits[5] = { 2, 3, 5, 7, 8 };
+	unit32 price = 0;
+	if (len == 2)
+		return offset < 256 ? 3 + 8 : offset <= 2303 ? 6 + 8 : 0xFFFF;
+	price = 2 + offset_bits[OffsetClass(offset)] + 8;
+	if (len <= 6)
+		price += len - 2;
+	else if (len <= 8)
+		price += 6;
+	else if (len <= 16)
+		price += 9;
+	else
+		price += 14;
+	return price;
+}
+
+static void PutMatch(IAR_Bit_Writer *bw, unit32 len, unit32 offset)
+{
+	static const unit32 offset_base[5] = { 1, 513, 1025, 2049, 4097 };
+	unit32 c = 0, nb = 0, tmp = 0, k = 0;
+	PutBit(bw, 0);
+	if (len == 2)
+	{
+		PutBit(bw, 0);
+		if (offset < 256)
+		{
+			PutBit(bw, 0);
+			*bw->out++ = offset - 1;//0xFFǽ
+		}
+		else
+		{
+			offset -= 256;
+			PutBit(bw, 1);
+			PutBit(bw, (offset >> 10) & 1);
+			PutBit(bw, (offset >> 9) & 1);
+			PutBit(bw, (offset >> 8) & 1);
+			*bw->out++ = offset & 0xFF;
+		}
+		return;
+	}
+	PutBit(bw, 1);
+	c = OffsetClass(offset);
+	nb = c <= 1 ? 1 : c;
+	tmp = (offset - offset_base[c]) >> 8;
+	PutBit(bw, (tmp >> (nb - 1)) & 1);
+	if (c == 0)
+		PutBit(bw, 1);
+	else
+	{
+		PutBit(bw, 0);
+		if (c == 1)
+			PutBit(bw, 1);
+		else
+		{
+			PutBit(bw, 0);
+			for (k = 1; k < c; k++)
+			{
+				PutBit(bw, (tmp >> (nb - 1 - k)) & 1);
+				if (k < c - 1)
+					PutBit(bw, 0);
+				else if (c < 4)
+					PutBit(bw, 1);
+			}
+		}
+	}
+	*bw->out++ = (offset - offset_base[c]) & 0xFF;
+	if (len <= 6)
+	{
+		for (k = 3; k < len; k++)
+			PutBit(bw, 0);
+		PutBit(bw, 1);
+	}
+	else if (len <= 8)
+	{
+		for (k = 0; k < 4; k++)
+			PutBit(bw, 0);
+		PutBit(bw, 1);
+		PutBit(bw, len - 7);
+	}
+	else
+	{
+		for (k = 0; k < 5; k++)
+			PutBit(bw, 0);
+		if (len <= 16)
+		{
+			PutBit(bw, 0);
+			PutBit(bw, ((len - 9) >> 2) & 1);
+			PutBit(bw, ((len - 9) >> 1) & 1);
+			PutBit(bw, (len - 9) & 1);
+		}
+		else
+		{
+			PutBit(bw, 1);
+			*bw->out++ = len - 17;
+		}
+	}
+}
+
+#define IAR_BASE_NUM 16//дĶ֡Ե׼ͼ
+
+typedef struct base_frame
+{
+	unit32 index;//iarе
+	unit32 flag;
+	unit32 width;
+	unit32 height;
+	unit32 stride;
+	unit8 *data;//strideе
+	unit64 *row_hash;
+}BaseFrame;
+static BaseFrame Bases[IAR_BASE_NUM];
+static unit32 BaseNum = 0, BaseNext = 0;
+
+//ÿصFNV-1aϣ׼ͼʱȰбȽ
+unit64* HashRows(struct iar_image_header *hdr, unit8 *data)
+{
+	unit32 i = 0, j = 0, row_bytes = hdr->width * (hdr->flag == 0x3C ? 4 : 3);
+	unit64 *row_hash = malloc(hdr->height * sizeof(unit64));
+	for (i = 0; i < hdr->height; i++)
+	{
+		unit64 h = 0xCBF29CE484222325ULL;
+		unit8 *row = data + i * hdr->stride;
+		for (j = 0; j < row_bytes; j++)
+			h = (h ^ row[j]) * 0x100000001B3ULL;
+		row_hash[i] = h;
+	}
+	return row_hash;
+}
+
+//֡дͼµļɵ
+void AddBase(unit32 index, struct iar_image_header *hdr, unit8 *data, unit64 *row_hash)
+{
+	BaseFrame *b = &Bases[BaseNext];
+	if (BaseNum == IAR_BASE_NUM)
+	{
+		free(b->data);
+		free(b->row_hash);
+	}
+	else
+		BaseNum++;
+	b->index = index;
+	b->flag = hdr->flag;
+	b->width = hdr->width;
+	b->height = hdr->height;
+	b->stride = hdr->stride;
+	b->data = malloc(hdr->uncomprlen);
+	memcpy(b->data, data, hdr->uncomprlen);
+	b->row_hash = row_hash;
+	BaseNext = (BaseNext + 1) % IAR_BASE_NUM;
+}
+
+void FreeBases()
+{
+	for (unit32 i = 0; i < BaseNum; i++)
+	{
+		free(Bases[i].data);
+		free(Bases[i].row_hash);
+	}
+	BaseNum = 0;
+	BaseNext = 0;
+}
+
+/*
+ͬߴͬʽ֡ͬٵĵ׼ͼ0x83C/0x81CõĲݣ
+iar_image_delta_header֮start_lineÿ2ֽڵĶÿ2ֽ2ֽݡ
+4ֽڵκϲһΣȶдһͷ㡣
+ݲ֡һʱŲã򷵻NULL
+*/
+unit8* BuildDelta(struct iar_image_header *hdr, struct iar_image_delta_header *delta_hdr, unit8 *data, unit64 *row_hash, unit32 *len)
+{
+	unit32 i = 0, j = 0, x = 0, bpp = hdr->flag == 0x3C ? 4 : 3;
+	unit32 best_rows = hdr->height / 2, first = 0, last = 0;
+	BaseFrame *base = NULL;
+	unit8 *delta = NULL, *p = NULL;
+	for (i = 0; i < BaseNum; i++)
+	{
+		BaseFrame *b = &Bases[i];
+		unit32 rows = 0;
+		if (b->flag != hdr->flag || b->width != hdr->width || b->height != hdr->height || b->stride != hdr->stride)
+			continue;
+		for (j = 0; j < hdr->height && rows < best_rows; j++)
+			if (b->row_hash[j] != row_hash[j])
+				rows++;
+		if (rows < best_rows)
+		{
+			best_rows = rows;
+			base = b;
+		}
+	}
+	if (base == NULL)
+		return NULL;
+	for (first = 0; first < hdr->height && base->row_hash[first] == row_hash[first] &&
+		memcmp(base->data + first * hdr->stride, data + first * hdr->stride, hdr->width * bpp) == 0; first++);
+	for (last = hdr->height; last > first && base->row_hash[last - 1] == row_hash[last - 1] &&
+		memcmp(base->data + (last - 1) * hdr->stride, data + (last - 1) * hdr->stride, hdr->width * bpp) == 0; last--);
+	delta_hdr->base_image_id = base->index;
+	delta_hdr->start_line = first;
+	delta_hdr->lines = last - first;
+	delta = malloc(sizeof(struct iar_image_delta_header) + (last - first) * (2 + hdr->width * (4 + bpp)));
+	memcpy(delta, delta_hdr, sizeof(struct iar_image_delta_header));
+	p = delta + sizeof(struct iar_image_delta_header);
+	for (i = first; i < last; i++)
+	{
+		unit8 *cur = data + i * hdr->stride, *org = base->data + i * hdr->stride;
+		unit16 *cnt = (unit16 *)p;
+		unit32 done = 0;
+		p += 2;
+		*cnt = 0;
+		x = 0;
+		while (x < hdr->width)
+		{
+			unit32 start = 0, end = 0;
+			if (memcmp(cur + x * bpp, org + x * bpp, bpp) == 0)
+			{
+				x++;
+				continue;
+			}
+			start = x;
+			end = x + 1;
+			while (end < hdr->width)
+			{
+				unit32 gap = 0;
+				while (end + gap < hdr->width && memcmp(cur + (end + gap) * bpp, org + (end + gap) * bpp, bpp) == 0)
+					gap++;
+				if (end + gap == hdr->width || (gap && gap * bpp > 4))
+					break;
+				end += gap + 1;
+			}
+			*(unit16 *)p = start - done;
+			*(unit16 *)(p + 2) = end - start;
+			memcpy(p + 4, cur + start * bpp, (end - start) * bpp);
+			p += 4 + (end - start) * bpp;
+			(*cnt)++;
+			done = end;
+			x = end;
+		}
+	}
+	*len = p - delta;
+	if (*len * 2 >= hdr->uncomprlen)
+	{
+		free(delta);
+		return NULL;
+	}
+	return delta;
+}
+
+/*
+iar_uncompress̡ϣҳÿλøƥ䣬
+ٰʵʱλһ鶯̬滮ȡλٵĽʽ
+صĻɵfree
+*/
+unit8* iar_compress(unit8 *uncompr, unit32 uncomprlen, unit32 *comprlen)
+{
+	unit32 i = 0, l = 0, skip = 0;
+	unit32 *price = malloc((uncomprlen + 1) * sizeof(unit32));
+	unit16 *from_len = malloc((uncomprlen + 1) * sizeof(unit16));
+	unit16 *from_off = malloc((uncomprlen + 1) * sizeof(unit16));
+	int *head = malloc(sizeof(int) << IAR_HASH_BITS);
+	int *head2 = malloc(sizeof(int) * 0x10000);//Ϊ2ƥֻһγ
+	int *prev = malloc((uncomprlen + 1) * sizeof(int));
+	unit8 *compr = malloc(uncomprlen + uncomprlen / 8 + 0x10);
+	IAR_Bit_Writer bw;
+	memset(head, 0xFF, sizeof(int) << IAR_HASH_BITS);
+	memset(head2, 0xFF, sizeof(int) * 0x10000);
+	memset(price, 0xFF, (uncomprlen + 1) * sizeof(unit32));
+	price[0] = 0;
+	for (i = 0; i < uncomprlen; i++)
+	{
+		unit32 max = uncomprlen - i < IAR_MAX_MATCH ? uncomprlen - i : IAR_MAX_MATCH;
+		unit32 hash = 0;
+		if (price[i] + 9 < price[i + 1])
+		{
+			price[i + 1] = price[i] + 9;
+			from_len[i + 1] = 1;
+		}
+		if (max >= 2 && i >= skip)
+		{
+			int cur = head2[*(unit16 *)&uncompr[i]];
+			if (cur >= 0 && i - cur <= 2303 && price[i] + MatchPrice(2, i - cur) < price[i + 2])
+			{
+				price[i + 2] = price[i] + MatchPrice(2, i - cur);
+				from_len[i + 2] = 2;
+				from_off[i + 2] = i - cur;
+			}
+		}
+		if (max >= 3)
+		{
+			unit32 best = 2, chain = IAR_MAX_CHAIN;
+			int cur = 0;
+			hash = ((uncompr[i] << 16 | uncompr[i + 1] << 8 | uncompr[i + 2]) * 2654435761U) >> (32 - IAR_HASH_BITS);
+			cur = head[hash];
+			while (i >= skip && cur >= 0 && i - cur <= IAR_MAX_OFFSET && chain-- > 0)
+			{
+				if (uncompr[cur + best] == uncompr[i + best])
+				{
+					unit32 len = 0;
+					while (len < max && uncompr[cur + len] == uncompr[i + len])
+						len++;
+					//ԽoffsetԽԸ̵ĳǰƥ
+					for (l = best + 1; l <= len; l++)
+						if (price[i] + MatchPrice(l, i - cur) < price[i + l])
+						{
+							price[i + l] = price[i] + MatchPrice(l, i - cur);
+							from_len[i + l] = l;
+							from_off[i + l] = i - cur;
+						}
+					if (len > best)
+						best = len;
+					if (best == max)
+						break;
+				}
+				cur = prev[cur];
+			}
+			if (best >= IAR_NICE_MATCH && i + best > skip)
+				skip = i + best;
+			prev[i] = head[hash];
+			head[hash] = i;
+		}
+		if (max >= 2)
+			head2[*(unit16 *)&uncompr[i]] = i;
+	}
+	//βݣÿһյprice
+	for (i = uncomprlen; i > 0; i -= from_len[i])
+		price[i - from_len[i]] = i;
+	bw.out = compr;
+	bw.flag = NULL;
+	bw.bits = 16;
+	for (i = 0; i < uncomprlen; i = price[i])
+	{
+		unit32 next = price[i];
+		if (from_len[next] == 1)
+		{
+			PutBit(&bw, 1);
+			*bw.out++ = uncompr[i];
+		}
+		else
+			PutMatch(&bw, from_len[next], from_off[next]);
+	}
+	//ǣƥoffsetΪ256
+	PutBit(&bw, 0);
+	PutBit(&bw, 0);
+	PutBit(&bw, 0);
+	*bw.out++ = 0xFF;
+	*comprlen = bw.out - compr;
+	free(price);
+	free(from_len);
+	free(from_off);
+	free(head);
+	free(head2);
+	free(prev);
+	return compr;
+}
\ No newline at end of file
@@ -14,6 +14,8 @@ made by Darkness-TX
 #include <locale.h>
 #include <time.h>
 #include <png.h>
+#include "res2.h"
+#include "iar_compress.h"
 
 typedef unsigned char  unit8;
 typedef unsigned short unit16;
@@ -33,28 +35,8 @@ struct iar_header {
 	unit32 total_num;
 }IAR_Header;
 
-struct iar_image_header {
-	unit16 flag;
-	unit8 zerobyte;
-	unit8 is_compress;//0 / 1
-	unit32 unk0;//0
-	unit32 uncomprlen;
-	unit32 palettesize;
-	unit32 comprlen;
-	unit32 unk1;//0
-	unit32 X;
-	unit32 Y;
-	unit32 width;
-	unit32 height;
-	unit32 stride;
-	unit8 bytes[0x1C];
-}IAR_Image_Header;
-
-struct iar_image_delta_header {
-	unit32 base_image_id;
-	unit32 start_line;
-	unit32 lines;
-} IAR_Image_Delta_Header;
+struct iar_image_header IAR_Image_Header;
+struct iar_image_delta_header IAR_Image_Delta_Header;
 
 typedef struct fileinfo
 {
@@ -65,83 +47,12 @@ typedef struct fileinfo
 }NodeFileInfo, *LinkFileInfo;
 LinkFileInfo FileInfo = NULL;
 
-unit32 ReadNumber(FILE *src, unit32 length_code)
-{
-	unit32 count = 0, i = 0, n = 0, rank = 0, b = 0;
-	count = (length_code & 7) + 1;
-	if (count > 4)
-	{
-		printf("count4pos:0x%X opcode:0x%X\n", ftell(src), count);
-		system("pause");
-		exit(0);
-	}
-	for (i = 0; i < count; ++i)
-	{
-		fread(&b, 1, 1, src);
-		n |= b << rank;
-		rank += 8;
-	}
-	if (count <= 3)
-	{
-		unit32 sign = n & (1 << (8 * count - 1));
-		if (sign != 0)
-			n -= sign << 1;
-	}
-	return n;
-}
-
-unit32 ReadInteger(FILE *src)
-{
-	unit32 opcode = 0;
-	fread(&opcode, 1, 1, src);
-	if ((opcode & 0xE0) != 0)
-	{
-		if ((opcode & 0xF8) != 0x80)
-		{
-			printf("opcodeΪ0x80pos:0x%X opcode:0x%X\n", ftell(src) - 1, opcode);
-			system("pause");
-			exit(0);
-		}
-		opcode = ReadNumber(src, opcode);
-	}
-	else
-		opcode = (opcode & 0x0F) - (opcode & 0x10);
-	return opcode;
-}
-
-void SkipObject(FILE *src)
-{
-	unit32 opcode = 0;
-	fread(&opcode, 1, 1, src);
-	if ((opcode & 0xE0) != 0)
-		ReadNumber(src, opcode);
-}
-
-void ReadString(FILE *src, char *dstname)
-{
-	unit32 opcode = 0, offset = 4, name_length = 0, savepos = 0;
-	char name_str[MAX_PATH];
-	fread(&opcode, 1, 1, src);
-	if ((opcode & 0xF8) != 0x90)
-	{
-		printf("opcode0x90pos:0x%X opcode:0x%X\n", ftell(src) - 1, opcode);
-		system("pause");
-		exit(0);
-	}
-	offset += ReadNumber(src, opcode);
-	savepos = ftell(src);
-	fseek(src, offset, SEEK_SET);
-	fread(&name_length, 4, 1, src);
-	fread(name_str, name_length, 1, src);
-	name_str[name_length] = '\0';
-	sprintf(dstname, "%s", name_str);
-	fseek(src, savepos, SEEK_SET);
-}
-
 void ReadIndex(char *fname)
 {
-	unit32 opcode_off = 0, name_count = 0, param_count = 0, arc_index = 0, i = 0, j = 0;
-	char name[MAX_PATH], type[MAX_PATH], arc_type[MAX_PATH], arc_name[MAX_PATH], param_name[MAX_PATH], *filename = NULL;
+	unit32 i = 0;
+	char *filename = NULL;
+	RES2_Info *res = NULL;
+	RES2_Entry *entry = NULL;
 	FileInfo = malloc(sizeof(NodeFileInfo));
 	FileInfo->next = NULL;
 	LinkFileInfo p = FileInfo;
@@ -149,52 +60,21 @@ void ReadIndex(char *fname)
 		filename = strrchr(fname, '\\') + 1;
 	else
 		filename = fname;
-	FILE *src = fopen("SEC5/RES2", "rb");
-	if (src == NULL)
+	res = Res2Load("SEC5/RES2");
+	for (i = 0; i < res->entry_num; i++)
 	{
-		printf("RES2򿪴SEC5ļǷRES2\n");
-		system("pause");
-		exit(0);
-	}
-	fread(&opcode_off, 4, 1, src);
-	opcode_off += 4;
-	fseek(src, opcode_off, SEEK_SET);
-	fread(&name_count, 4, 1, src);
-	for (i = 0; i < name_count; i++)
-	{
-		ReadString(src, name);
-		ReadString(src, type);
-		ReadString(src, arc_type);
-		param_count = ReadInteger(src);
-		arc_index = 0;
-		arc_name[0] = '\0';
-		for (j = 0; j < param_count; j++)
-		{
-			ReadString(src, param_name);
-			if (strncmp("path", param_name, 4) == 0)
-				ReadString(src, arc_name);
-			else if (strncmp("arc-index", param_name, 9) == 0)
-				arc_index = ReadInteger(src);
-			else if (strncmp("arc-path", param_name, 8) == 0)
-				ReadString(src, name);
-			else
-			{
-				printf("δ֪Ĳ%s offset:0x%X\n", param_name, ftell(src));
-				system("pause");
-				SkipObject(src);
-			}
-		}
-		if (strcmp(filename, arc_name) == 0)
+		entry = &res->entry[i];
+		if (strcmp(filename, entry->arc_name) == 0)
 		{
 			p->next = malloc(sizeof(NodeFileInfo));
-			sprintf(p->next->filename, "%s.png", name);
-			p->next->index = arc_index;
+			sprintf(p->next->filename, "%s.png", entry->arc_path[0] ? entry->arc_path : entry->name);
+			p->next->index = entry->arc_index;
 			p = p->next;
 			p->next = NULL;
-			//printf("arc_name:%s arc_index:%d arc_type:%s file_name:%s file_type:%s \n", arc_name, arc_index, arc_type, name, type);
+			//printf("arc_name:%s arc_index:%d arc_type:%s file_name:%s file_type:%s \n", entry->arc_name, entry->arc_index, entry->arc_type, entry->name, entry->type);
 		}
 	}
-	fclose(src);
+	Res2Free(res);
 }
 
 void ReadPng(FILE *pngfile, unit8 *bitmapdata,unit32 org_bpp)
@@ -304,7 +184,7 @@ void PackFile(char *fname)
 	FILE *src = NULL, *dst = NULL, *fp = NULL;
 	unit32 i = 0, j = 0, filesize = 0;
 	unit64 offset = 0;
-	unit8 *udata = NULL, *dst_data = NULL;
+	unit8 *udata = NULL, *dst_data = NULL, *cdata = NULL;
 	LinkFileInfo p = FileInfo;
 	char dstname[MAX_PATH];
 	src = fopen(fname, "rb");
@@ -369,7 +249,6 @@ void PackFile(char *fname)
 			p->offset = _ftelli64(dst);
 			if (IAR_Image_Header.flag == 0x3C)
 			{
-				IAR_Image_Header.is_compress = 0;
 				printf("\t%s offset:0x%llX stride:0x%X width:%d height:%d bpp:32 flag:0x%X ", dstname, p->offset, IAR_Image_Header.stride, IAR_Image_Header.width, IAR_Image_Header.height, IAR_Image_Header.flag);
 				fp = fopen(dstname, "rb");
 				udata = malloc(IAR_Image_Header.width * IAR_Image_Header.height * 4);
@@ -380,7 +259,6 @@ void PackFile(char *fname)
 			}
 			else if (IAR_Image_Header.flag == 0x1C)
 			{
-				IAR_Image_Header.is_compress = 0;
 				printf("\t%s offset:0x%llX stride:0x%X width:%d height:%d bpp:24 flag:0x%X ", dstname, p->offset, IAR_Image_Header.stride, IAR_Image_Header.width, IAR_Image_Header.height, IAR_Image_Header.flag);
 				fp = fopen(dstname, "rb");
 				udata = malloc(IAR_Image_Header.width * IAR_Image_Header.height * 3);
@@ -391,7 +269,6 @@ void PackFile(char *fname)
 			}
 			else if (IAR_Image_Header.flag == 0x02)
 			{
-				IAR_Image_Header.is_compress = 0;
 				printf("\t%s offset:0x%llX stride:0x%X width:%d height:%d bpp:8 flag:0x%X ", dstname, p->offset, IAR_Image_Header.stride, IAR_Image_Header.width, IAR_Image_Header.height, IAR_Image_Header.flag);
 				fp = fopen(dstname, "rb");
 				udata = malloc(IAR_Image_Header.width * IAR_Image_Header.height);
@@ -402,7 +279,6 @@ void PackFile(char *fname)
 			}
 			else if (IAR_Image_Header.flag == 0x83C)
 			{
-				IAR_Image_Header.is_compress = 0;
 				printf("\t%s offset:0x%llX stride:0x%X width:%d height:%d bpp:32 flag:0x%X ", dstname, p->offset, IAR_Image_Header.stride, IAR_Image_Header.width, IAR_Image_Header.height, IAR_Image_Header.flag);
 				fp = fopen(dstname, "rb");
 				udata = malloc(IAR_Image_Header.width * IAR_Image_Header.height * 4);
@@ -412,12 +288,12 @@ void PackFile(char *fname)
 				IAR_Image_Header.uncomprlen = IAR_Image_Header.stride * IAR_Image_Header.height;
 				free(dst_data);
 				dst_data = malloc(IAR_Image_Header.uncomprlen);
+				memset(dst_data, 0, IAR_Image_Header.uncomprlen);
 				for (j = 0; j < IAR_Image_Header.height; j++)
 					memcpy(&dst_data[j * IAR_Image_Header.stride], &udata[j * IAR_Image_Header.width * 4], IAR_Image_Header.width * 4);
 			}
 			else if (IAR_Image_Header.flag == 0x81C)
 			{
-				IAR_Image_Header.is_compress = 0;
 				printf("\t%s offset:0x%llX stride:0x%X width:%d height:%d bpp:24 flag:0x%X ", dstname, p->offset, IAR_Image_Header.stride, IAR_Image_Header.width, IAR_Image_Header.height, IAR_Image_Header.flag);
 				fp = fopen(dstname, "rb");
 				udata = malloc(IAR_Image_Header.width * IAR_Image_Header.height * 3);
@@ -427,6 +303,7 @@ void PackFile(char *fname)
 				IAR_Image_Header.uncomprlen = IAR_Image_Header.stride * IAR_Image_Header.height;
 				free(dst_data);
 				dst_data = malloc(IAR_Image_Header.uncomprlen);
+				memset(dst_data, 0, IAR_Image_Header.uncomprlen);
 				for (j = 0; j < IAR_Image_Header.height; j++)
 					memcpy(&dst_data[j * IAR_Image_Header.stride], &udata[j * IAR_Image_Header.width * 3], IAR_Image_Header.width * 3);
 			}
@@ -438,10 +315,37 @@ void PackFile(char *fname)
 				exit(0);
 			}
 			free(udata);
-			IAR_Image_Header.comprlen = IAR_Image_Header.uncomprlen;
+			if (IAR_Image_Header.flag == 0x3C || IAR_Image_Header.flag == 0x1C)
+			{
+				unit64 *row_hash = HashRows(&IAR_Image_Header, dst_data);
+				unit32 delta_len = 0;
+				unit8 *delta = BuildDelta(&IAR_Image_Header, &IAR_Image_Delta_Header, dst_data, row_hash, &delta_len);
+				if (delta)
+				{
+					printf("base:%d start_line:%d lines:%d ", IAR_Image_Delta_Header.base_image_id, IAR_Image_Delta_Header.start_line, IAR_Image_Delta_Header.lines);
+					IAR_Image_Header.flag |= 0x800;
+					IAR_Image_Header.uncomprlen = delta_len;
+					free(dst_data);
+					free(row_hash);
+					dst_data = delta;
+				}
+				else
+					AddBase(i, &IAR_Image_Header, dst_data, row_hash);
+			}
+			cdata = iar_compress(dst_data, IAR_Image_Header.uncomprlen, &IAR_Image_Header.comprlen);
+			IAR_Image_Header.is_compress = 1;
+			if (IAR_Image_Header.comprlen >= IAR_Image_Header.uncomprlen)//ѹľԭ
+			{
+				free(cdata);
+				cdata = dst_data;
+				dst_data = NULL;
+				IAR_Image_Header.is_compress = 0;
+				IAR_Image_Header.comprlen = IAR_Image_Header.uncomprlen;
+			}
 			printf("uncomprlen:0x%X comprlen:0x%X\n", IAR_Image_Header.uncomprlen, IAR_Image_Header.comprlen);
 			fwrite(&IAR_Image_Header, sizeof(IAR_Image_Header), 1, dst);
-			fwrite(dst_data, IAR_Image_Header.uncomprlen, 1, dst);
+			fwrite(cdata, IAR_Image_Header.comprlen, 1, dst);
+			free(cdata);
 			free(dst_data);
 			fseek(dst, i * 8 + 0x20, SEEK_SET);
 			fwrite(&p->offset, 8, 1, dst);
@@ -454,6 +358,7 @@ void PackFile(char *fname)
 		}
 		FileNum++;
 	}
+	FreeBases();
 	fclose(src);
 	fclose(dst);
 }
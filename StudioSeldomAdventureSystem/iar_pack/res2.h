@@ -0,0 +1,43 @@
+#include <Windows.h>
+
+//RES2еһԴ¼ַָRES2_Info.poolûиòʱΪմ
+typedef struct res2_entry
+{
+	unsigned int offset;//¼RES2еλ
+	unsigned int size;//¼ĳ
+	char *name;
+	char *type;
+	char *arc_type;
+	char *arc_name;//path
+	char *arc_path;//arc-path
+	int arc_index;
+	unsigned int path_pos, path_len;//pathֵRES2еλúͳȣдʱ滻
+	unsigned int index_pos, index_len;//arc-indexֵRES2еλúͳ
+	unsigned int new_path;//дʱpathַָƫ
+	int new_index;//дʱarc-index
+	BOOL modified;
+	struct res2_entry *hash_next;//ͬһϣͰеһ
+}RES2_Entry;
+
+typedef struct res2_info
+{
+	unsigned char *data;//RES2ļ
+	unsigned int size;
+	unsigned int str_size;//ַС
+	char *pool;//ַеַԭƫƴŲ\0
+	unsigned char *new_str;//дʱ׷ӵַĩβַ
+	unsigned int new_str_size, new_str_cap;
+	unsigned int entry_end;//һ¼Ľλã֮ԭд
+	unsigned int entry_num;
+	RES2_Entry *entry;//RES2е˳
+	RES2_Entry **hash;
+	unsigned int hash_mask;
+}RES2_Info;
+
+RES2_Info* Res2Load(char *fname);
+RES2_Entry* Res2Find(RES2_Info *res, char *name);
+RES2_Entry* Res2FindNext(RES2_Entry *entry);
+unsigned int Res2AddString(RES2_Info *res, char *str);
+void Res2SetArc(RES2_Entry *entry, unsigned int path, int index);
+void Res2Save(RES2_Info *res, char *fname);
+void Res2Free(RES2_Info *res);
\ No newline at end of file
@@ -14,6 +14,7 @@ made by Darkness-TX
 #include <locale.h>
 #include <time.h>
 #include <png.h>
+#include "res2.h"
 
 typedef unsigned char  unit8;
 typedef unsigned short unit16;
@@ -21,6 +22,7 @@ typedef unsigned int   unit32;
 typedef unsigned __int64 unit64;
 
 unit32 FileNum = 0;//ļʼΪ0
+BOOL WritePatch = FALSE;//ͼǷֻв첿ֵpng
 
 struct iar_header {
 	unit8 magic[4];//"iar "
@@ -64,6 +66,18 @@ typedef struct fileinfo
 }NodeFileInfo, *LinkFileInfo;
 LinkFileInfo FileInfo = NULL;
 
+#define IAR_CACHE_NUM 8//Žͼͬһ׼ͼļʮŲͼ÷
+
+typedef struct frame_cache
+{
+	unit32 index;//iarе
+	unit32 size;//stride * height
+	unit8 *data;//strideе
+	unit32 last_use;
+}FrameCache;
+FrameCache Cache[IAR_CACHE_NUM];
+unit32 CacheNum = 0, CacheTick = 0;
+
 #define flag_shift \
 	flag >>= 1;	\
 	if (flag <= 0xffff) \
@@ -251,143 +265,243 @@ void WritePng(FILE *Pngname, unit32 Width, unit32 Height, unit32 bpp, unit8* Bit
 	png_destroy_write_struct(&png_ptr, &info_ptr);
 }
 
-unit32 ReadNumber(FILE *src,unit32 length_code)
+void ReadIndex(char *fname)
 {
-	unit32 count = 0, i = 0, n = 0, rank = 0, b = 0;
-	count = (length_code & 7) + 1;
-	if (count > 4)
+	unit32 i = 0;
+	char *filename = NULL;
+	RES2_Info *res = NULL;
+	RES2_Entry *entry = NULL;
+	FileInfo = malloc(sizeof(NodeFileInfo));
+	FileInfo->next = NULL;
+	LinkFileInfo p = FileInfo;
+	if (strrchr(fname, '\\') != NULL)
+		filename = strrchr(fname, '\\') + 1;
+	else
+		filename = fname;
+	res = Res2Load("SEC5/RES2");
+	for (i = 0; i < res->entry_num; i++)
 	{
-		printf("count4pos:0x%X count:0x%X\n", ftell(src), count);
-		system("pause");
-		exit(0);
+		entry = &res->entry[i];
+		if (strcmp(filename, entry->arc_name) == 0)
+		{
+			p->next = malloc(sizeof(NodeFileInfo));
+			sprintf(p->next->filename, "%s.png", entry->name);
+			p->next->index = entry->arc_index;
+			p = p->next;
+			p->next = NULL;
+			//printf("arc_name:%s arc_index:%d arc_type:%s file_name:%s file_type:%s \n", entry->arc_name, entry->arc_index, entry->arc_type, entry->name, entry->type);
+		}
+	}
+	Res2Free(res);
+}
+
+unit8* FindCache(unit32 index, unit32 size)
+{
+	for (unit32 i = 0; i < CacheNum; i++)
+		if (Cache[i].index == index && Cache[i].size == size)
+		{
+			Cache[i].last_use = ++CacheTick;
+			return Cache[i].data;
+		}
+	return NULL;
+}
+
+//data˾ͼûù
+void PutCache(unit32 index, unit8 *data, unit32 size)
+{
+	unit32 i = 0, slot = CacheNum;
+	if (CacheNum == IAR_CACHE_NUM)
+	{
+		slot = 0;
+		for (i = 1; i < CacheNum; i++)
+			if (Cache[i].last_use < Cache[slot].last_use)
+				slot = i;
+		free(Cache[slot].data);
+	}
+	else
+		CacheNum++;
+	Cache[slot].index = index;
+	Cache[slot].size = size;
+	Cache[slot].data = data;
+	Cache[slot].last_use = ++CacheTick;
+}
+
+void FreeCache()
+{
+	for (unit32 i = 0; i < CacheNum; i++)
+		free(Cache[i].data);
+	CacheNum = 0;
+}
+
+//indexͼƬļͷͽѹ
+unit8* ReadImage(FILE *src, unit32 index, struct iar_image_header *header, unit64 *offset)
+{
+	unit8 *cdata = NULL, *udata = NULL;
+	_fseeki64(src, index * 8 + 0x20, SEEK_SET);
+	fread(offset, 8, 1, src);
+	_fseeki64(src, *offset, SEEK_SET);
+	fread(header, sizeof(struct iar_image_header), 1, src);
+	if (header->is_compress == 1)
+	{
+		cdata = malloc(header->comprlen);
+		fread(cdata, header->comprlen, 1, src);
+		udata = malloc(header->uncomprlen);
+		iar_uncompress(udata, cdata);
+		free(cdata);
 	}
-	for (i = 0; i < count; ++i)
+	else if (header->is_compress == 0)
 	{
-		fread(&b, 1, 1, src);
-		n |= b << rank;
-		rank += 8;
+		udata = malloc(header->uncomprlen);
+		fread(udata, header->uncomprlen, 1, src);
 	}
-	if (count <= 3)
+	else
 	{
-		unit32 sign = n & (1 << (8 * count - 1));
-		if (sign != 0)
-			n -= sign << 1;
+		printf("δ֪is_compress־λ,is_compress:0x%X\n", header->is_compress);
+		system("pause");
+		exit(0);
 	}
-	return n;
+	return udata;
 }
 
-unit32 ReadInteger(FILE *src)
+//ѲݰframeϣframeΪ׼ͼʱõͼΪȫ0ʱֻв첿
+void ApplyDelta(unit8 *frame, unit8 *udata, unit32 bpp, unit32 stride)
 {
-	unit32 opcode = 0;
-	fread(&opcode, 1, 1, src);
-	if ((opcode & 0xE0)!=0)
+	struct iar_image_delta_header *delta = (struct iar_image_delta_header *)udata;
+	unit8 *start = udata + sizeof(struct iar_image_delta_header);
+	unit8 *cur_line = frame + stride * delta->start_line;
+	for (unit32 j = 0; j < delta->lines; j++)
 	{
-		if ((opcode & 0xF8)!=0x80)
+		unit8 *datadst = cur_line;
+		unit32 cnt = *(unit16 *)start;
+		start += 2;
+		for (DWORD l = 0; l < cnt; l++)
 		{
-			printf("opcodeΪ0x80pos:0x%X opcode:0x%X\n", ftell(src) - 1, opcode);
-			system("pause");
-			exit(0);
+			unit32 pos = *(unit16 *)start * bpp;
+			start += 2;
+			unit32 count = *(unit16 *)start * bpp;
+			start += 2;
+			datadst += pos;
+			memcpy(datadst, start, count);
+			start += count;
+			datadst += count;
 		}
-		opcode = ReadNumber(src,opcode);
+		cur_line += stride;
 	}
-	else
-		opcode = (opcode & 0x0F) - (opcode & 0x10);
-	return opcode;
 }
 
-void SkipObject(FILE *src)
+unit8* GetBase(FILE *src, unit32 index, unit32 size, unit32 depth);
+
+/*
+indexͼƬstrideеأͼȡ׼ͼϲ첿֡
+patchΪNULLʱͼⷵȫ0ϵֻв첿ֵͼ
+palettesizeΪ0ķNULL
+*/
+unit8* DecodeFrame(FILE *src, unit32 index, struct iar_image_header *header, unit64 *offset, unit8 **patch, unit32 depth)
 {
-	unit32 opcode = 0;
-	fread(&opcode, 1, 1, src);
-	if ((opcode & 0xE0) != 0)
-		ReadNumber(src, opcode);
+	struct iar_image_delta_header delta;
+	unit8 *udata = ReadImage(src, index, header, offset), *frame = NULL, *base = NULL;
+	unit32 size = header->stride * header->height, bpp = header->flag == 0x83C ? 4 : 3;
+	if (patch)
+		*patch = NULL;
+	if (header->palettesize != 0)
+	{
+		free(udata);
+		return NULL;
+	}
+	if (header->flag != 0x83C && header->flag != 0x81C)
+		return udata;
+	memcpy(&delta, udata, sizeof(delta));
+	frame = malloc(size);
+	//׼ͼҲǲͼƲֹ
+	if (depth < 8 && delta.base_image_id != index && delta.base_image_id < IAR_Header.file_num)
+		base = GetBase(src, delta.base_image_id, size, depth + 1);
+	if (base)
+		memcpy(frame, base, size);
+	else
+	{
+		printf("\tҲߴͬĻ׼ͼ%d첿͸\n", delta.base_image_id);
+		memset(frame, 0, size);
+	}
+	ApplyDelta(frame, udata, bpp, header->stride);
+	if (patch)
+	{
+		*patch = malloc(size);
+		memset(*patch, 0, size);
+		ApplyDelta(*patch, udata, bpp, header->stride);
+	}
+	free(udata);
+	return frame;
 }
 
-void ReadString(FILE *src,char *dstname)
+//׼ͼȲ黺棬ûٽ벢Ž棬صݹ黺
+unit8* GetBase(FILE *src, unit32 index, unit32 size, unit32 depth)
 {
-	unit32 opcode = 0, offset = 4, name_length = 0, savepos = 0;
-	char name_str[MAX_PATH];
-	fread(&opcode, 1, 1, src);
-	if ((opcode & 0xF8)!=0x90)
+	struct iar_image_header header;
+	unit64 offset = 0;
+	unit8 *frame = FindCache(index, size);
+	if (frame)
+		return frame;
+	frame = DecodeFrame(src, index, &header, &offset, NULL, depth);
+	if (frame == NULL)
+		return NULL;
+	if (header.stride * header.height != size)
 	{
-		printf("opcode0x90pos:0x%X opcode:0x%X\n", ftell(src) - 1, opcode);
-		system("pause");
-		exit(0);
+		free(frame);
+		return NULL;
 	}
-	offset += ReadNumber(src, opcode);
-	savepos = ftell(src);
-	fseek(src, offset, SEEK_SET);
-	fread(&name_length, 4, 1, src);
-	fread(name_str, name_length, 1, src);
-	name_str[name_length] = '\0';
-	sprintf(dstname, "%s", name_str);
-	fseek(src, savepos, SEEK_SET);
+	PutCache(index, frame, size);
+	return frame;
 }
 
-void ReadIndex(char *fname)
+void WriteFrame(char *fname, struct iar_image_header *header, unit8 *frame)
 {
-	unit32 opcode_off = 0, name_count = 0, param_count = 0, arc_index = 0, i = 0, j = 0;
-	char name[MAX_PATH], type[MAX_PATH], arc_type[MAX_PATH], arc_name[MAX_PATH], param_name[MAX_PATH], *filename = NULL;
-	FileInfo = malloc(sizeof(NodeFileInfo));
-	FileInfo->next = NULL;
-	LinkFileInfo p = FileInfo;
-	if (strrchr(fname, '\\') != NULL)
-		filename = strrchr(fname, '\\') + 1;
-	else
-		filename = fname;
-	FILE *src = fopen("SEC5/RES2", "rb");
-	if (src == NULL)
+	FILE *dst = NULL;
+	unit32 j = 0, k = 0;
+	unit8 *dst_data = NULL;
+	if (header->flag == 0x3C || header->flag == 0x83C)
 	{
-		printf("RES2򿪴SEC5ļǷRES2\n");
-		system("pause");
-		exit(0);
+		printf("bpp:32\n");
+		dst_data = malloc(header->width * header->height * 4);
+		for (j = 0; j < header->height; j++)
+			memcpy(&dst_data[j * header->width * 4], &frame[j * header->stride], header->width * 4);
 	}
-	fread(&opcode_off, 4, 1, src);
-	opcode_off += 4;
-	fseek(src, opcode_off, SEEK_SET);
-	fread(&name_count, 4, 1, src);
-	for (i = 0; i < name_count; i++)
+	else if (header->flag == 0x1C || header->flag == 0x81C)
 	{
-		ReadString(src, name);
-		ReadString(src, type);
-		ReadString(src, arc_type);
-		param_count = ReadInteger(src);
-		arc_index = 0;
-		arc_name[0] = '\0';
-		for (j = 0; j < param_count; j++)
-		{
-			ReadString(src, param_name);
-			if (strncmp("path", param_name, 4) == 0)
-				ReadString(src, arc_name);
-			else if (strncmp("arc-index", param_name, 9) == 0)
-				arc_index = ReadInteger(src);
-			else if (strncmp("arc-path", param_name, 8) == 0)
-				SkipObject(src);
-			else
+		printf("bpp:24\n");
+		dst_data = malloc(header->width * header->height * 3);
+		for (j = 0; j < header->height; j++)
+			memcpy(&dst_data[j * header->width * 3], &frame[j * header->stride], header->width * 3);
+	}
+	else if (header->flag == 0x02)
+	{
+		printf("bpp:8\n");
+		dst_data = malloc(header->width * header->height * 4);
+		for (j = 0; j < header->height; j++)
+			for (k = 0; k < header->width; k++)
 			{
-				printf("δ֪Ĳ%s offset:0x%X\n", param_name, ftell(src));
-				system("pause");
-				SkipObject(src);
+				memset(&dst_data[(j * header->width + k) * 4], frame[j * header->stride + k], 3);
+				dst_data[(j * header->width + k) * 4 + 3] = 255;
 			}
-		}
-		if (strcmp(filename, arc_name) == 0)
-		{
-			p->next = malloc(sizeof(NodeFileInfo));
-			sprintf(p->next->filename, "%s.png", name);
-			p->next->index = arc_index;
-			p = p->next;
-			p->next = NULL;
-			//printf("arc_name:%s arc_index:%d arc_type:%s file_name:%s file_type:%s \n", arc_name, arc_index, arc_type, name, type);
-		}
 	}
+	else
+	{
+		printf("flag:0x%X\n", header->flag);
+		printf("δflag־λ!\n");
+		system("pause");
+		exit(0);
+	}
+	dst = fopen(fname, "wb");
+	WritePng(dst, header->width, header->height, header->flag == 0x1C || header->flag == 0x81C ? 24 : 32, dst_data);
+	fclose(dst);
+	free(dst_data);
 }
 
 void UnpackFile(char *fname)
 {
-	FILE *src = NULL, *dst = NULL;
-	unit32 i = 0, j = 0;
+	FILE *src = NULL;
+	unit32 i = 0;
 	unit64 offset = 0;
-	unit8 *cdata = NULL, *udata = NULL, *dst_data = NULL;
+	unit8 *frame = NULL, *patch = NULL;
 	LinkFileInfo p = FileInfo;
 	char dstname[MAX_PATH];
 	src = fopen(fname, "rb");
@@ -422,10 +536,6 @@ void UnpackFile(char *fname)
 	_chdir(dstname);
 	for (i = 0; i < IAR_Header.file_num; i++)
 	{
-		fseek(src, i * 8 + 0x20, SEEK_SET);
-		fread(&offset, 8, 1, src);
-		_fseeki64(src, offset, SEEK_SET);
-		fread(&IAR_Image_Header, sizeof(IAR_Image_Header), 1, src);
 		if (p->next != NULL)
 		{
 			p = p->next;
@@ -441,153 +551,40 @@ void UnpackFile(char *fname)
 		}
 		else
 			sprintf(dstname, "%08d.png", i);
+		frame = DecodeFrame(src, i, &IAR_Image_Header, &offset, WritePatch ? &patch : NULL, 0);
 		printf("\t%s offset:0x%llX stride:0x%X uncomprlen:0x%X comprlen:0x%X width:%d height:%d flag:0x%X ", dstname, offset, IAR_Image_Header.stride, IAR_Image_Header.uncomprlen, IAR_Image_Header.comprlen, IAR_Image_Header.width, IAR_Image_Header.height, IAR_Image_Header.flag);
-		if (IAR_Image_Header.is_compress == 1)
-		{
-			cdata = malloc(IAR_Image_Header.comprlen);
-			fread(cdata, IAR_Image_Header.comprlen, 1, src);
-			udata = malloc(IAR_Image_Header.uncomprlen);
-			iar_uncompress(udata, cdata);
-			free(cdata);
-		}
-		else if(IAR_Image_Header.is_compress == 0)
+		if (frame == NULL)
 		{
-			udata = malloc(IAR_Image_Header.uncomprlen);
-			fread(udata, IAR_Image_Header.uncomprlen, 1, src);
-		}
-		else
-		{
-			printf("δ֪is_compress־λ,is_compress:0x%X\n", IAR_Image_Header.is_compress);
+			printf("palettesizeΪ0palettesize:0x%X\n", IAR_Image_Header.palettesize);
 			system("pause");
-			exit(0);
 		}
-		dst = fopen(dstname, "wb");
-		if (IAR_Image_Header.palettesize == 0)
+		else
 		{
-			if (IAR_Image_Header.flag == 0x3C)
-			{
-				printf("bpp:32\n");
-				dst_data = malloc(IAR_Image_Header.width * IAR_Image_Header.height * 4);
-				for (j = 0; j < IAR_Image_Header.height; j++)
-					memcpy(&dst_data[j * IAR_Image_Header.width * 4], &udata[j * IAR_Image_Header.stride], IAR_Image_Header.width * 4);
-				WritePng(dst, IAR_Image_Header.width, IAR_Image_Header.height, 32, dst_data);
-				free(dst_data);
-			}
-			else if (IAR_Image_Header.flag == 0x02)
-			{
-				printf("bpp:8\n");
-				cdata = malloc(IAR_Image_Header.width * IAR_Image_Header.height);
-				for (j = 0; j < IAR_Image_Header.height; j++)
-					memcpy(&cdata[j * IAR_Image_Header.width], &udata[j * IAR_Image_Header.stride], IAR_Image_Header.width);
-				dst_data = malloc(IAR_Image_Header.width * IAR_Image_Header.height * 4);
-				for (j = 0; j < IAR_Image_Header.height * IAR_Image_Header.width; j++)
-				{
-					memset(&dst_data[j * 4 + 0], cdata[j], 3);
-					dst_data[j * 4 + 3] = 255;
-				}
-				free(cdata);
-				WritePng(dst, IAR_Image_Header.width, IAR_Image_Header.height, 32, dst_data);
-				free(dst_data);
-			}
-			else if (IAR_Image_Header.flag == 0x1C)
+			WriteFrame(dstname, &IAR_Image_Header, frame);
+			if (patch)
 			{
-				printf("bpp:24\n");
-				dst_data = malloc(IAR_Image_Header.width * IAR_Image_Header.height * 3);
-				for (j = 0; j < IAR_Image_Header.height; j++)
-					memcpy(&dst_data[j * IAR_Image_Header.width * 3], &udata[j * IAR_Image_Header.stride], IAR_Image_Header.width * 3);
-				WritePng(dst, IAR_Image_Header.width, IAR_Image_Header.height, 24, dst_data);
-				free(dst_data);
-			}
-			else if (IAR_Image_Header.flag == 0x83C)
-			{
-				printf("bpp:32\n");
-				cdata = malloc(IAR_Image_Header.stride * IAR_Image_Header.height);
-				memset(cdata, 0, IAR_Image_Header.stride * IAR_Image_Header.height);
-				memcpy(&IAR_Image_Delta_Header, udata, sizeof(IAR_Image_Delta_Header));
-				unit8 *start = udata + sizeof(IAR_Image_Delta_Header);
-				unit8 *cur_line = cdata + IAR_Image_Header.stride * IAR_Image_Delta_Header.start_line;
-				for (j = 0; j < IAR_Image_Delta_Header.lines; j++)
-				{
-					unit8 *datadst = cur_line;
-					unit32 cnt = *(unit16 *)start;
-					start += 2;
-					for (DWORD l = 0; l < cnt; l++)
-					{
-						unit16 pos = *(unit16 *)start * 4;
-						start += 2;
-						unit16 count = *(unit16 *)start * 4;
-						start += 2;
-						datadst += pos;
-						memcpy(datadst, start, count);
-						start += count;
-						datadst += count;
-					}
-					cur_line += IAR_Image_Header.stride;
-				}
-				dst_data = malloc(IAR_Image_Header.width * IAR_Image_Header.height * 4);
-				for (j = 0; j < IAR_Image_Header.height; j++)
-					memcpy(&dst_data[j * IAR_Image_Header.width * 4], &cdata[j * IAR_Image_Header.stride], IAR_Image_Header.width * 4);
-				free(cdata);
-				WritePng(dst, IAR_Image_Header.width, IAR_Image_Header.height, 32, dst_data);
-				free(dst_data);
-			}
-			else if (IAR_Image_Header.flag == 0x81C)
-			{
-				printf("bpp:24\n");
-				cdata = malloc(IAR_Image_Header.stride * IAR_Image_Header.height);
-				memset(cdata, 0, IAR_Image_Header.stride * IAR_Image_Header.height);
-				memcpy(&IAR_Image_Delta_Header, udata, sizeof(IAR_Image_Delta_Header));
-				unit8 *start = udata + sizeof(IAR_Image_Delta_Header);
-				unit8 *cur_line = cdata + IAR_Image_Header.stride * IAR_Image_Delta_Header.start_line;
-				for (j = 0; j < IAR_Image_Delta_Header.lines; j++)
-				{
-					unit8 *datadst = cur_line;
-					unit32 cnt = *(unit16 *)start;
-					start += 2;
-					for (DWORD l = 0; l < cnt; l++)
-					{
-						unit16 pos = *(unit16 *)start * 3;
-						start += 2;
-						unit16 count = *(unit16 *)start * 3;
-						start += 2;
-						datadst += pos;
-						memcpy(datadst, start, count);
-						start += count;
-						datadst += count;
-					}
-					cur_line += IAR_Image_Header.stride;
-				}
-				dst_data = malloc(IAR_Image_Header.width * IAR_Image_Header.height * 3);
-				for (j = 0; j < IAR_Image_Header.height; j++)
-					memcpy(&dst_data[j * IAR_Image_Header.width * 3], &cdata[j * IAR_Image_Header.stride], IAR_Image_Header.width * 3);
-				free(cdata);
-				WritePng(dst, IAR_Image_Header.width, IAR_Image_Header.height, 24, dst_data);
-				free(dst_data);
+				sprintf(strrchr(dstname, '.'), "_delta.png");
+				printf("\t\t%s ", dstname);
+				WriteFrame(dstname, &IAR_Image_Header, patch);
+				free(patch);
 			}
+			//ĲͼԸսͼΪ׼
+			if (FindCache(i, IAR_Image_Header.stride * IAR_Image_Header.height))
+				free(frame);
 			else
-			{
-				printf("flag:0x%X\n", IAR_Image_Header.flag);
-				printf("δflag־λ!\n");
-				system("pause");
-				exit(0);
-			}
+				PutCache(i, frame, IAR_Image_Header.stride * IAR_Image_Header.height);
 		}
-		else
-		{
-			printf("palettesizeΪ0palettesize:0x%X\n", IAR_Image_Header.palettesize);
-			system("pause");
-		}
-		fclose(dst);
-		free(udata);
 		FileNum++;
 	}
+	FreeCache();
 	fclose(src);
 }
 
 int main(int argc, char *argv[])
 {
 	setlocale(LC_ALL, "chs");
-	printf("projectNiflheim-StudioSeldomAdventureSystem\nڽļͷΪiar iarļ\niarļϵϡ\nby Darkness-TX 2018.05.24\n\n");
+	printf("projectNiflheim-StudioSeldomAdventureSystem\nڽļͷΪiar iarļ\niarļϵϡ\nͼ׼ͼͼڶΪ-dʱֻв첿ֵxxx_delta.png\nby Darkness-TX 2018.05.24\n\n");
+	WritePatch = argc > 2 && strcmp(argv[2], "-d") == 0;
 	ReadIndex(argv[1]);
 	UnpackFile(argv[1]);
 	printf("ɣļ%d\n", FileNum);
@@ -269,9 +269,8 @@ void CPZIndexEncrypt1(unit8* Buff, unit32 IndexLength, unit32 IndexKey)
 	}
 }
 
-unit8* GetByteTable2(unit32 Key, unit32 Seed)
+void GetByteTable2(unit8* ByteTable, unit32 Key, unit32 Seed)
 {
-	unit8 ByteTable[0x100];
 	unit32 i = 0;
 	for (i = 0; i < 0x100; i++)
 		ByteTable[i] = i;
@@ -288,12 +287,12 @@ unit8* GetByteTable2(unit32 Key, unit32 Seed)
 		Key *= 0x1a74f195;
 		Key += Seed;
 	}
-	return ByteTable;
 }
 
 void CPZIndexEncrypt2(unit8* IndexBuff, unit32 IndexLength, unit32 IndexKey, unit32 Seed)
 {
-	unit8* ByteTable = GetByteTable2(IndexKey, Seed);
+	unit8 ByteTable[0x100];
+	GetByteTable2(ByteTable, IndexKey, Seed);
 	unit32 j = 0;
 	for (unit32 i = 0; i < IndexLength; i++)
 	{
@@ -350,7 +349,8 @@ unit32* GetFileIndexKey2(unit32 DirKey)
 
 void CPZFileIndexEncrypt1(unit8* Buff, unit32 Length, unit32 Key, unit32 Seed)
 {
-	unit8* ByteTable = GetByteTable2(Key, Seed);
+	unit8 ByteTable[0x100];
+	GetByteTable2(ByteTable, Key, Seed);
 	unit32 j = 0;
 	for (unit32 i = 0; i < Length; i++)
 	{
@@ -388,33 +388,44 @@ void CPZFileIndexEncrypt2(unit8* FileIndexBuff, unit32 Length, unit32 DirKey)
 	}
 }
 
-void CPZResourceEncrypt(unit8* FileBuff, unit32 Length, unit32 IndexKey, unit32* Md5Data, unit32 Seed)
+typedef struct cpz_key_ctx
+{
+	unit32 Md5Data[4];
+	unit8 ByteTable[0x100];//GetByteTable2(Md5Data[3], IndexKey)ֻļͷйأֻһ
+	unit8 ByteTableInv[0x100];//ByteTableʱֽڱ
+	unit32 BaseKey[16];//δSeedļԿԭDecryptKey[32]ʵֻõǰ16dword
+}CPZ_Key_Ctx;
+CPZ_Key_Ctx CPZ_Key;
+
+void InitCPZKeyCtx(CPZ_Key_Ctx* ctx, unit32 IndexKey, unit32* Md5Data)
+{
+	unit8* p = (unit8*)ctx->BaseKey;
+	unit8 Key = (unit8)(Md5Data[1] >> 2);
+	memcpy(ctx->Md5Data, Md5Data, sizeof(ctx->Md5Data));
+	GetByteTable2(ctx->ByteTable, Md5Data[3], IndexKey);
+	for (unit32 i = 0; i < 0x100; i++)
+		ctx->ByteTableInv[ctx->ByteTable[i]] = i;
+	for (unit32 i = 0; i < sizeof(ctx->BaseKey); i++)
+		p[i] = Key ^ ctx->ByteTable[ByteString[i]];
+}
+
+void CPZResourceEncrypt(CPZ_Key_Ctx* ctx, unit8* FileBuff, unit32 Length, unit32 Seed)
 {
-	unit32 DecryptKey[32], j = 0;
+	unit32 DecryptKey[16];
 	unit32* Buff = (unit32*)FileBuff;
-	unit32 Key = Md5Data[1] >> 2;
-	unit8* ByteTable = GetByteTable2(Md5Data[3], IndexKey);
-	unit8* p = (unit8*)DecryptKey;
-	for (unit32 i = 0; i < 96; i++)
-		p[i] = (unit8)Key ^ ByteTable[ByteString[i] & 0xff];
-	for (unit32 i = 0; i < 24; i++)
-		DecryptKey[i] ^= Seed;
-	Key = 0x2748c39e;
+	for (unit32 i = 0; i < 16; i++)
+		DecryptKey[i] = ctx->BaseKey[i] ^ Seed;
+	unit32 Key = 0x2748c39e;
 	unit32 Flag = 0x0a;
 	for (unit32 i = Length / 4 * 4; i < Length; i++)
-	{
-		for (j = 0; j < 0x100; j++)
-			if (FileBuff[i] == ByteTable[j])
-				break;
-		FileBuff[i] = j ^ 0xae;
-	}
+		FileBuff[i] = ctx->ByteTableInv[FileBuff[i]] ^ 0xae;
 	for (unit32 i = 0; i < Length / 4; i++)
 	{
 		unit32 Temp = DecryptKey[Flag];
 		Temp >>= 1;
 		Temp ^= DecryptKey[(Key >> 6) & 0xf];
 		unit32 Temp2 = Buff[i];
-		Temp2 ^= Md5Data[Key & 3];
+		Temp2 ^= ctx->Md5Data[Key & 3];
 		Temp2 += Seed;
 		Key = Key + Seed + Buff[i];
 		Buff[i] = Temp ^ Temp2;
@@ -468,6 +479,7 @@ void MakeCPZ6File(char* fname)
 	CPZ_Header.FileIndexLength = 0;
 	CPZ_Header.IndexKey = time(NULL);//ǰʱkey
 	MakeRandData();//ʼ
+	InitCPZKeyCtx(&CPZ_Key, CPZ_Header.IndexKey, cmvsMd5Data);
 	if (CPZ_Header.DirCount > 0)
 	{
 		LinkCPZ_Dir_Index q;
@@ -522,7 +534,7 @@ void MakeCPZ6File(char* fname)
 				fread(data, p->Length, 1, src);
 				fclose(src);
 				if (CPZ_Header.IsEncrypt)
-					CPZResourceEncrypt(data, p->Length, CPZ_Header.IndexKey, cmvsMd5Data, IndexSeed ^ ((CPZ_Header.IndexKey ^ (q->DirKey + p->FileKey)) + CPZ_Header.DirCount + 0xa3d61785));
+					CPZResourceEncrypt(&CPZ_Key, data, p->Length, IndexSeed ^ ((CPZ_Header.IndexKey ^ (q->DirKey + p->FileKey)) + CPZ_Header.DirCount + 0xa3d61785));
 				p->CRC = CheckCRC(data, p->Length, 0x5A902B7C);//sub_455D90 in ChronoClock
 				p->Offset = ftell(dst) - sizeof(CPZ_Header) - CPZ_Header.DirIndexLength - CPZ_Header.FileIndexLength;
 				fwrite(data, p->Length, 1, dst);
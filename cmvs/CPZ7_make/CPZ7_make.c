@@ -57,16 +57,14 @@ struct cpz_header
 	unit32 HeaderCRC;
 }CPZ_Header;
 
+#pragma pack(1)
 typedef struct cpz_file_index
 {
 	unit32 IndexLength;
-	//unit64Ԥģڵİ汾лmov eax, dword ptr [esi+0xC]...........
-	//unit64 Offset;
-	unit32 Offset;
-	unit32 unk1;//0
-	//unit64 Length;
-	unit32 Length;
-	unit32 unk2;
+	//OffsetLengthڸʽ϶unit64ǰunit32+unk
+	//а汾滹mov eax, dword ptr [esi+0xC]ֻ32λ4GBķҪ汾֧
+	unit64 Offset;
+	unit64 Length;
 	unit32 CRC;
 	unit32 FileKey;
 	unit8* FileNameSave;
@@ -74,6 +72,7 @@ typedef struct cpz_file_index
 	LPWSTR FileName;
 	struct cpz_file_index* next;
 }NodeCPZ_File_Index, * LinkCPZ_FIle_Index;
+#pragma pack()
 
 typedef struct cpz_dir_index
 {
@@ -103,14 +102,14 @@ unit32 process_dir(char* dname)
 {
 	long Handle;
 	unit32 i = 0;
-	struct _wfinddata_t FileInfo;
+	struct _wfinddatai64_t FileInfo;
 	_chdir(dname);//ת·
 	LinkCPZ_Dir_Index q;
 	q = malloc(sizeof(NodeCPZ_Dir_Index));
 	q->file_index = NULL;
 	q->next = NULL;
 	CPZ_Dir_Index = q;
-	if ((Handle = _wfindfirst(L"*.*", &FileInfo)) == -1L)
+	if ((Handle = _wfindfirsti64(L"*.*", &FileInfo)) == -1L)
 	{
 		printf("ûҵƥĿ\n");
 		system("pause");
@@ -139,14 +138,14 @@ unit32 process_dir(char* dname)
 		row->FileCount = 0;
 		q->next = row;
 		q = q->next;
-	} while (_wfindnext(Handle, &FileInfo) == 0);
+	} while (_wfindnexti64(Handle, &FileInfo) == 0);
 	q = CPZ_Dir_Index;
 	CPZ_Header.DirCount = 0;
 	while (q->next)
 	{
 		q = q->next;
 		_wchdir(q->DirName);
-		if ((Handle = _wfindfirst(L"*.*", &FileInfo)) == -1L)
+		if ((Handle = _wfindfirsti64(L"*.*", &FileInfo)) == -1L)
 		{
 			printf("ûҵƥĿ\n");
 			system("pause");
@@ -173,6 +172,13 @@ unit32 process_dir(char* dname)
 				row->IndexLength = 0x1C + row->NameLength + (4 - (row->NameLength % 4));
 			row->FileKey = (unit32)FileInfo.time_create;//Keyѡôʱ棬֤32λ
 			row->Length = FileInfo.size;
+			//ܺCRCǰ32λ鴦ģ4GBļܽض
+			if (row->Length > 0xFFFFFFFF)
+			{
+				wprintf(L"ļ4GBݲ֧֣%ls\n", row->FileName);
+				system("pause");
+				exit(0);
+			}
 			if (q->FileCount == 0)//ͷ
 			{
 				q->file_index = row;
@@ -185,7 +191,7 @@ unit32 process_dir(char* dname)
 			}
 			q->FileCount++;
 			FileNum++;
-		} while (_wfindnext(Handle, &FileInfo) == 0);
+		} while (_wfindnexti64(Handle, &FileInfo) == 0);
 		_wchdir(L"..");
 		CPZ_Header.DirCount++;
 	}
@@ -306,9 +312,8 @@ void CPZIndexEncrypt1(unit8* Buff, unit32 IndexLength, unit32 IndexKey)
 	}
 }
 
-unit8* GetByteTable2(unit32 Key, unit32 Seed)
+void GetByteTable2(unit8* ByteTable, unit32 Key, unit32 Seed)
 {
-	unit8 ByteTable[0x100];
 	unit32 i = 0;
 	for (i = 0; i < 0x100; i++)
 		ByteTable[i] = i;
@@ -325,12 +330,12 @@ unit8* GetByteTable2(unit32 Key, unit32 Seed)
 		Key *= 0x1a74f195;
 		Key += Seed;
 	}
-	return ByteTable;
 }
 
 void CPZIndexEncrypt2(unit8* IndexBuff, unit32 IndexLength, unit32 IndexKey, unit32 Seed)
 {
-	unit8* ByteTable = GetByteTable2(IndexKey, Seed);
+	unit8 ByteTable[0x100];
+	GetByteTable2(ByteTable, IndexKey, Seed);
 	unit32 j = 0;
 	for (unit32 i = 0; i < IndexLength; i++)
 	{
@@ -387,7 +392,8 @@ unit32* GetFileIndexKey2(unit32 DirKey)
 
 void CPZFileIndexEncrypt1(unit8* Buff, unit32 Length, unit32 Key, unit32 Seed)
 {
-	unit8* ByteTable = GetByteTable2(Key, Seed);
+	unit8 ByteTable[0x100];
+	GetByteTable2(ByteTable, Key, Seed);
 	unit32 j = 0;
 	for (unit32 i = 0; i < Length; i++)
 	{
@@ -425,33 +431,44 @@ void CPZFileIndexEncrypt2(unit8* FileIndexBuff, unit32 Length, unit32 DirKey)
 	}
 }
 
-void CPZResourceEncrypt(unit8* FileBuff, unit32 Length, unit32 IndexKey, unit32* Md5Data, unit32 Seed)
+typedef struct cpz_key_ctx
+{
+	unit32 Md5Data[4];
+	unit8 ByteTable[0x100];//GetByteTable2(Md5Data[3], IndexKey)ֻļͷйأֻһ
+	unit8 ByteTableInv[0x100];//ByteTableʱֽڱ
+	unit32 BaseKey[16];//δSeedļԿԭDecryptKey[32]ʵֻõǰ16dword
+}CPZ_Key_Ctx;
+CPZ_Key_Ctx CPZ_Key;
+
+void InitCPZKeyCtx(CPZ_Key_Ctx* ctx, unit32 IndexKey, unit32* Md5Data)
+{
+	unit8* p = (unit8*)ctx->BaseKey;
+	unit8 Key = (unit8)(Md5Data[1] >> 2);
+	memcpy(ctx->Md5Data, Md5Data, sizeof(ctx->Md5Data));
+	GetByteTable2(ctx->ByteTable, Md5Data[3], IndexKey);
+	for (unit32 i = 0; i < 0x100; i++)
+		ctx->ByteTableInv[ctx->ByteTable[i]] = i;
+	for (unit32 i = 0; i < sizeof(ctx->BaseKey); i++)
+		p[i] = Key ^ ctx->ByteTable[ByteString[i]];
+}
+
+void CPZResourceEncrypt(CPZ_Key_Ctx* ctx, unit8* FileBuff, unit32 Length, unit32 Seed)
 {
-	unit32 DecryptKey[32], j = 0;
+	unit32 DecryptKey[16];
 	unit32* Buff = (unit32*)FileBuff;
-	unit32 Key = Md5Data[1] >> 2;
-	unit8* ByteTable = GetByteTable2(Md5Data[3], IndexKey);
-	unit8* p = (unit8*)DecryptKey;
-	for (unit32 i = 0; i < 96; i++)
-		p[i] = (unit8)Key ^ ByteTable[ByteString[i] & 0xff];
-	for (unit32 i = 0; i < 24; i++)
-		DecryptKey[i] ^= Seed;
-	Key = 0x2748c39e;
+	for (unit32 i = 0; i < 16; i++)
+		DecryptKey[i] = ctx->BaseKey[i] ^ Seed;
+	unit32 Key = 0x2748c39e;
 	unit32 Flag = 0x0a;
 	for (unit32 i = Length / 4 * 4; i < Length; i++)
-	{
-		for (j = 0; j < 0x100; j++)
-			if (FileBuff[i] == ByteTable[j])
-				break;
-		FileBuff[i] = j ^ 0xae;
-	}
+		FileBuff[i] = ctx->ByteTableInv[FileBuff[i]] ^ 0xae;
 	for (unit32 i = 0; i < Length / 4; i++)
 	{
 		unit32 Temp = DecryptKey[Flag];
 		Temp >>= 1;
 		Temp ^= DecryptKey[(Key >> 6) & 0xf];
 		unit32 Temp2 = Buff[i];
-		Temp2 ^= Md5Data[Key & 3];
+		Temp2 ^= ctx->Md5Data[Key & 3];
 		Temp2 += Seed;
 		Key = Key + Seed + Buff[i];
 		Buff[i] = Temp ^ Temp2;
@@ -505,6 +522,7 @@ void MakeCPZ7File(char* fname)
 	CPZ_Header.FileIndexLength = 0;
 	CPZ_Header.IndexKey = time(NULL);//ǰʱkey
 	MakeRandData();//ʼ
+	InitCPZKeyCtx(&CPZ_Key, CPZ_Header.IndexKey, cmvsMd5Data);
 	CPZ_Header.IndexKeySize = HuffmanSize;
 	if (CPZ_Header.DirCount > 0)
 	{
@@ -544,7 +562,7 @@ void MakeCPZ7File(char* fname)
 		//дļ
 		sprintf(filename, "%s.cpz", fname);
 		dst = fopen(filename, "wb+");
-		fseek(dst, sizeof(CPZ_Header) + CPZ_Header.DirIndexLength + CPZ_Header.FileIndexLength + CPZ_Header.IndexKeySize, SEEK_SET);
+		_fseeki64(dst, sizeof(CPZ_Header) + CPZ_Header.DirIndexLength + CPZ_Header.FileIndexLength + CPZ_Header.IndexKeySize, SEEK_SET);
 		_chdir(fname);
 		q = CPZ_Dir_Index;
 		while (q->next)
@@ -560,12 +578,12 @@ void MakeCPZ7File(char* fname)
 				fread(data, p->Length, 1, src);
 				fclose(src);
 				if (CPZ_Header.IsEncrypt)
-					CPZResourceEncrypt(data, p->Length, CPZ_Header.IndexKey, cmvsMd5Data, IndexSeed ^ ((CPZ_Header.IndexKey ^ (q->DirKey + p->FileKey)) + CPZ_Header.DirCount + 0xa3c61785));
-				p->CRC = CheckCRC(data, p->Length, 0x5A902B7C);//sub_455D90 in ChronoClock
-				p->Offset = ftell(dst) - sizeof(CPZ_Header) - CPZ_Header.DirIndexLength - CPZ_Header.FileIndexLength - CPZ_Header.IndexKeySize;
+					CPZResourceEncrypt(&CPZ_Key, data, (unit32)p->Length, IndexSeed ^ ((CPZ_Header.IndexKey ^ (q->DirKey + p->FileKey)) + CPZ_Header.DirCount + 0xa3c61785));
+				p->CRC = CheckCRC(data, (unit32)p->Length, 0x5A902B7C);//sub_455D90 in ChronoClock
+				p->Offset = _ftelli64(dst) - sizeof(CPZ_Header) - CPZ_Header.DirIndexLength - CPZ_Header.FileIndexLength - CPZ_Header.IndexKeySize;
 				fwrite(data, p->Length, 1, dst);
 				free(data);
-				wprintf(L"\t%s offset:0x%X size:0x%X file_key:0x%X crc:0x%X\n", p->FileName, p->Offset, p->Length, p->FileKey, p->CRC);
+				wprintf(L"\t%s offset:0x%llX size:0x%llX file_key:0x%X crc:0x%X\n", p->FileName, p->Offset, p->Length, p->FileKey, p->CRC);
 				p = p->next;
 			}
 			_wchdir(L"..");
@@ -592,12 +610,8 @@ void MakeCPZ7File(char* fname)
 			while (p)
 			{
 				fwrite(&p->IndexLength, 4, 1, dst);
-				fwrite(&p->Offset, 4, 1, dst);
-				p->unk1 = 0;
-				fwrite(&p->unk1, 4, 1, dst);
-				fwrite(&p->Length, 4, 1, dst);
-				p->unk2 = 0;
-				fwrite(&p->unk2, 4, 1, dst);
+				fwrite(&p->Offset, 8, 1, dst);
+				fwrite(&p->Length, 8, 1, dst);
 				fwrite(&p->CRC, 4, 1, dst);
 				fwrite(&p->FileKey, 4, 1, dst);
 				fwrite(p->FileNameSave, p->IndexLength - 0x1C, 1, dst);
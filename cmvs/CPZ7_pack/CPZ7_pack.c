@@ -11,6 +11,8 @@ made by Darkness-TX
 #include <direct.h>
 #include <Windows.h>
 #include <locale.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include "MD5.h"
 #include "cmvs_md5.h"
 #include "HuffmanDecoder.h"
@@ -21,6 +23,7 @@ typedef unsigned int   unit32;
 typedef unsigned __int64 unit64;
 
 unit32 FileNum = 0;//ļʼΪ0
+unit32 ReuseNum = 0;//ģʽֱԭݵļ
 
 struct cpz_header
 {
@@ -38,21 +41,20 @@ struct cpz_header
 	unit32 HeaderCRC;
 }CPZ_Header, CPZ_Header_new;
 
+#pragma pack(1)
 typedef struct cpz_file_index
 {
 	unit32 IndexLength;
-	//unit64Ԥģڵİ汾лmov eax, dword ptr [esi+0xC]...........
-	//unit64 Offset;
-	unit32 Offset;
-	unit32 unk1;
-	//unit64 Length;
-	unit32 Length;
-	unit32 unk2;
+	//OffsetLengthڸʽ϶unit64ǰunit32+unk
+	//а汾滹mov eax, dword ptr [esi+0xC]ֻ32λ4GBķҪ汾֧
+	unit64 Offset;
+	unit64 Length;
 	unit32 CRC;
 	unit32 FileKey;
 	LPWSTR FileName;
 	struct cpz_file_index* next;
 }NodeCPZ_File_Index, * LinkCPZ_FIle_Index;
+#pragma pack()
 
 typedef struct cpz_dir_index
 {
@@ -257,9 +259,8 @@ void CPZIndexEncrypt1(unit8* Buff, unit32 IndexLength, unit32 IndexKey)
 	}
 }
 
-unit8* GetByteTable2(unit32 Key, unit32 Seed)
+void GetByteTable2(unit8* ByteTable, unit32 Key, unit32 Seed)
 {
-	unit8 ByteTable[0x100];
 	unit32 i = 0;
 	for (i = 0; i < 0x100; i++)
 		ByteTable[i] = i;
@@ -276,19 +277,20 @@ unit8* GetByteTable2(unit32 Key, unit32 Seed)
 		Key *= 0x1a74f195;
 		Key += Seed;
 	}
-	return ByteTable;
 }
 
 void CPZIndexDecrypt2(unit8* IndexBuff, unit32 IndexLength, unit32 IndexKey, unit32 Seed)
 {
-	unit8* ByteTable = GetByteTable2(IndexKey, Seed);
+	unit8 ByteTable[0x100];
+	GetByteTable2(ByteTable, IndexKey, Seed);
 	for (unit32 i = 0; i < IndexLength; i++)
 		IndexBuff[i] = ByteTable[IndexBuff[i] ^ 0x3a];
 }
 
 void CPZIndexEncrypt2(unit8* IndexBuff, unit32 IndexLength, unit32 IndexKey, unit32 Seed)
 {
-	unit8* ByteTable = GetByteTable2(IndexKey, Seed);
+	unit8 ByteTable[0x100];
+	GetByteTable2(ByteTable, IndexKey, Seed);
 	unit32 j = 0;
 	for (unit32 i = 0; i < IndexLength; i++)
 	{
@@ -368,14 +370,16 @@ unit32* GetFileIndexKey2(unit32 DirKey)
 
 void CPZFileIndexDecrypt1(unit8* Buff, unit32 Length, unit32 Key, unit32 Seed)
 {
-	unit8* ByteTable = GetByteTable2(Key, Seed);
+	unit8 ByteTable[0x100];
+	GetByteTable2(ByteTable, Key, Seed);
 	for (unit32 i = 0; i < Length; i++)
 		Buff[i] = ByteTable[Buff[i] ^ 0x7e];
 }
 
 void CPZFileIndexEncrypt1(unit8* Buff, unit32 Length, unit32 Key, unit32 Seed)
 {
-	unit8* ByteTable = GetByteTable2(Key, Seed);
+	unit8 ByteTable[0x100];
+	GetByteTable2(ByteTable, Key, Seed);
 	unit32 j = 0;
 	for (unit32 i = 0; i < Length; i++)
 	{
@@ -552,33 +556,44 @@ unit8* ReadIndex(FILE* src)
 	return data;
 }
 
-void CPZResourceEncrypt(unit8* FileBuff, unit32 Length, unit32 IndexKey, unit32* Md5Data, unit32 Seed)
+typedef struct cpz_key_ctx
 {
-	unit32 DecryptKey[32], j = 0;
+	unit32 Md5Data[4];
+	unit8 ByteTable[0x100];//GetByteTable2(Md5Data[3], IndexKey)ֻļͷйأֻһ
+	unit8 ByteTableInv[0x100];//ByteTableʱֽڱ
+	unit32 BaseKey[16];//δSeedļԿԭDecryptKey[32]ʵֻõǰ16dword
+}CPZ_Key_Ctx;
+CPZ_Key_Ctx CPZ_Key;
+
+void InitCPZKeyCtx(CPZ_Key_Ctx* ctx, unit32 IndexKey, unit32* Md5Data)
+{
+	unit8* p = (unit8*)ctx->BaseKey;
+	unit8 Key = (unit8)(Md5Data[1] >> 2);
+	memcpy(ctx->Md5Data, Md5Data, sizeof(ctx->Md5Data));
+	GetByteTable2(ctx->ByteTable, Md5Data[3], IndexKey);
+	for (unit32 i = 0; i < 0x100; i++)
+		ctx->ByteTableInv[ctx->ByteTable[i]] = i;
+	for (unit32 i = 0; i < sizeof(ctx->BaseKey); i++)
+		p[i] = Key ^ ctx->ByteTable[ByteString[i]];
+}
+
+void CPZResourceEncrypt(CPZ_Key_Ctx* ctx, unit8* FileBuff, unit32 Length, unit32 Seed)
+{
+	unit32 DecryptKey[16];
 	unit32* Buff = (unit32*)FileBuff;
-	unit32 Key = Md5Data[1] >> 2;
-	unit8* ByteTable = GetByteTable2(Md5Data[3], IndexKey);
-	unit8* p = (unit8*)DecryptKey;
-	for (unit32 i = 0; i < 96; i++)
-		p[i] = (unit8)Key ^ ByteTable[ByteString[i] & 0xff];
-	for (unit32 i = 0; i < 24; i++)
-		DecryptKey[i] ^= Seed;
-	Key = 0x2748c39e;
+	for (unit32 i = 0; i < 16; i++)
+		DecryptKey[i] = ctx->BaseKey[i] ^ Seed;
+	unit32 Key = 0x2748c39e;
 	unit32 Flag = 0x0a;
 	for (unit32 i = Length / 4 * 4; i < Length; i++)
-	{
-		for (j = 0; j < 0x100; j++)
-			if (FileBuff[i] == ByteTable[j])
-				break;
-		FileBuff[i] = j ^ 0xae;
-	}
+		FileBuff[i] = ctx->ByteTableInv[FileBuff[i]] ^ 0xae;
 	for (unit32 i = 0; i < Length / 4; i++)
 	{
 		unit32 Temp = DecryptKey[Flag];
 		Temp >>= 1;
 		Temp ^= DecryptKey[(Key >> 6) & 0xf];
 		unit32 Temp2 = Buff[i];
-		Temp2 ^= Md5Data[Key & 3];
+		Temp2 ^= ctx->Md5Data[Key & 3];
 		Temp2 += Seed;
 		Key = Key + Seed + Buff[i];
 		Buff[i] = Temp ^ Temp2;
@@ -587,13 +602,15 @@ void CPZResourceEncrypt(unit8* FileBuff, unit32 Length, unit32 IndexKey, unit32*
 	}
 }
 
-void PackFile(char* fname)
+void PackFile(char* fname, BOOL Incremental)
 {
-	FILE* src, * dst;
+	FILE* src, * dst, * arc = NULL;
 	unit32 i = 0;
+	struct _stat64 ArcStat, FileStat;
 	src = fopen(fname, "rb");
 	unit8* data = NULL, *index_key = NULL;
 	unit8* indexdata = ReadIndex(src);
+	InitCPZKeyCtx(&CPZ_Key, CPZ_Header.IndexKey, CPZ_Header.Md5Data);
 	ReadDirIndex(indexdata);
 	ReadFileIndex(indexdata);
 	fclose(src);
@@ -601,8 +618,13 @@ void PackFile(char* fname)
 	wchar_t filename[MAX_PATH];
 	sprintf(dirname, "%s_new", fname);
 	dst = fopen(dirname, "wb");
-	unit32 headsize = sizeof(CPZ_Header) + CPZ_Header.DirIndexLength + CPZ_Header.FileIndexLength + CPZ_Header.IndexKeySize;
-	fseek(dst, headsize, SEEK_SET);
+	unit64 headsize = sizeof(CPZ_Header) + CPZ_Header.DirIndexLength + CPZ_Header.FileIndexLength + CPZ_Header.IndexKeySize;
+	_fseeki64(dst, headsize, SEEK_SET);
+	if (Incremental)
+	{
+		_stat64(fname, &ArcStat);
+		arc = fopen(fname, "rb");
+	}
 	sprintf(dirname, "%s_unpack", fname);
 	_chdir(dirname);
 	NodeCPZ_Dir_Index* q = CPZ_Dir_Index;
@@ -614,23 +636,45 @@ void PackFile(char* fname)
 		while (p)
 		{
 			wsprintfW(filename, L"%ls/%ls", q->DirName, p->FileName);
-			src = _wfopen(filename, L"rb");
-			fseek(src, 0, SEEK_END);
-			p->Length = ftell(src);
-			fseek(src, 0, SEEK_SET);
-			data = malloc(p->Length);
-			fread(data, p->Length, 1, src);
-			fclose(src);
-			if (CPZ_Header.IsEncrypt)
-				CPZResourceEncrypt(data, p->Length, CPZ_Header.IndexKey, CPZ_Header.Md5Data, CPZ_Header.IndexSeed ^ ((CPZ_Header.IndexKey ^ (q->DirKey + p->FileKey)) + CPZ_Header.DirCount + 0xa3c61785));
-			p->CRC = CheckCRC(data, p->Length, 0x5A902B7C);//sub_455D90 in ChronoClock
-			p->Offset = ftell(dst) - headsize;
+			//CPZ7_unpackļ޸ʱһ£С޸ʱ䶼ûļֱӰԭмܺݣCRCԭ
+			if (arc && _wstat64(filename, &FileStat) == 0 && FileStat.st_size == p->Length && FileStat.st_mtime == ArcStat.st_mtime)
+			{
+				_fseeki64(arc, headsize + p->Offset, SEEK_SET);
+				data = malloc(p->Length);
+				fread(data, p->Length, 1, arc);
+				ReuseNum++;
+			}
+			else
+			{
+				src = _wfopen(filename, L"rb");
+				_fseeki64(src, 0, SEEK_END);
+				p->Length = _ftelli64(src);
+				_fseeki64(src, 0, SEEK_SET);
+				//ܺCRCǰ32λ鴦ģ4GBļܽض
+				if (p->Length > 0xFFFFFFFF)
+				{
+					wprintf(L"\tļ4GBݲ֧֣%ls\n", filename);
+					fclose(src);
+					fclose(dst);
+					system("pause");
+					exit(0);
+				}
+				data = malloc(p->Length);
+				fread(data, p->Length, 1, src);
+				fclose(src);
+				if (CPZ_Header.IsEncrypt)
+					CPZResourceEncrypt(&CPZ_Key, data, (unit32)p->Length, CPZ_Header.IndexSeed ^ ((CPZ_Header.IndexKey ^ (q->DirKey + p->FileKey)) + CPZ_Header.DirCount + 0xa3c61785));
+				p->CRC = CheckCRC(data, (unit32)p->Length, 0x5A902B7C);//sub_455D90 in ChronoClock
+			}
+			p->Offset = _ftelli64(dst) - headsize;
 			fwrite(data, p->Length, 1, dst);
 			free(data);
-			wprintf(L"\t%s offset:0x%X size:0x%X file_key:0x%X crc:0x%X\n", p->FileName, p->Offset, p->Length, p->FileKey, p->CRC);
+			wprintf(L"\t%s offset:0x%llX size:0x%llX file_key:0x%X crc:0x%X\n", p->FileName, p->Offset, p->Length, p->FileKey, p->CRC);
 			p = p->next;
 		}
 	}
+	if (arc)
+		fclose(arc);
 	q = CPZ_Dir_Index;
 	while (q->next)
 	{
@@ -641,8 +685,8 @@ void PackFile(char* fname)
 			NodeCPZ_File_Index* p = q->file_index;
 			while (i < q->FileIndexLength)
 			{
-				memcpy(indexdata + q->FileIndexOffset + CPZ_Header.DirIndexLength + i + 4, &p->Offset, 4);
-				memcpy(indexdata + q->FileIndexOffset + CPZ_Header.DirIndexLength + i + 0x0C, &p->Length, 4);
+				memcpy(indexdata + q->FileIndexOffset + CPZ_Header.DirIndexLength + i + 4, &p->Offset, 8);
+				memcpy(indexdata + q->FileIndexOffset + CPZ_Header.DirIndexLength + i + 0x0C, &p->Length, 8);
 				memcpy(indexdata + q->FileIndexOffset + CPZ_Header.DirIndexLength + i + 0x14, &p->CRC, 4);
 				i += p->IndexLength;
 				p = p->next;
@@ -678,9 +722,11 @@ void PackFile(char* fname)
 int main(int argc, char* argv[])
 {
 	setlocale(LC_ALL, "chs");
-	printf("projectNiflheim-cmvs\nڷļͷΪCPZ7cpzļ\ncpzļϵϡ\nby Darkness-TX 2023.02.15\n\n");
-	PackFile(argv[1]);
+	printf("projectNiflheim-cmvs\nڷļͷΪCPZ7cpzļ\ncpzļϵϡ\nڶΪ-iʱֻ¼޸ĹļΪCPZ7_unpackļУ\nby Darkness-TX 2023.02.15\n\n");
+	PackFile(argv[1], argc > 2 && strcmp(argv[2], "-i") == 0);
 	printf("ɣļ%d\n", FileNum);
+	if (ReuseNum)
+		printf("δ޸ֱԭݵļ%d\n", ReuseNum);
 	system("pause");
 	return 0;
 }
\ No newline at end of file
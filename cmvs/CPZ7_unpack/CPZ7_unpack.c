@@ -11,6 +11,10 @@ made by Darkness-TX
 #include <direct.h>
 #include <Windows.h>
 #include <locale.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/utime.h>
+#include <emmintrin.h>
 #include "MD5.h"
 #include "cmvs_md5.h"
 #include "HuffmanDecoder.h"
@@ -21,6 +25,7 @@ typedef unsigned int   unit32;
 typedef unsigned __int64 unit64;
 
 unit32 FileNum = 0;//ļʼΪ0
+BOOL UseSSE2 = FALSE;//ʱ⣬֧ʱԭıѭ
 
 struct cpz_header
 {
@@ -38,21 +43,20 @@ struct cpz_header
 	unit32 HeaderCRC;
 }CPZ_Header;
 
+#pragma pack(1)
 typedef struct cpz_file_index
 {
 	unit32 IndexLength;
-	//unit64Ԥģڵİ汾лmov eax, dword ptr [esi+0xC]...........
-	//unit64 Offset;
-	unit32 Offset;
-	unit32 unk1;
-	//unit64 Length;
-	unit32 Length;
-	unit32 unk2;
+	//OffsetLengthڸʽ϶unit64ǰunit32+unk
+	//а汾滹mov eax, dword ptr [esi+0xC]ֻ32λ4GBķҪ汾֧
+	unit64 Offset;
+	unit64 Length;
 	unit32 CRC;
 	unit32 FileKey;
 	LPWSTR FileName;
 	struct cpz_file_index *next;
 }NodeCPZ_File_Index, *LinkCPZ_FIle_Index;
+#pragma pack()
 
 typedef struct cpz_dir_index
 {
@@ -156,14 +160,12 @@ unit8* UnpackIndexKey(unit8 *srcdata, unit32 offset, unit32 length)
 	return dstdata;
 }
 
-unit32* GetIndexTable1(unit32 IndexKey)
+void GetIndexTable1(unit32 *DwordString, unit32 IndexKey)
 {
 	IndexKey ^= 0x3795b39a;
-	unit32 DwordString[24];
 	memcpy(DwordString, ByteString, 96);
 	for (unit32 i = 0; i < 24; i++)
 		DwordString[i] -= IndexKey;
-	return DwordString;
 }
 
 unit8 GetIndexRorBit1(unit32 IndexKey)
@@ -182,13 +184,50 @@ unit8 GetIndexRorBit1(unit32 IndexKey)
 	return Temp;
 }
 
+/*
+SSE2汾ֻ4dwordĲ֣ѴdwordʣµĽԭıѭ
+±(5 + i) % 0x180x184ıԤȰѱתɴ5ʼ˳ܰ128λȡ
+ûAVX2汾ֻڴ򿪷ʱһΣһֻмʮKBSSE2֮ѾԺԣ
+ٶһAVX2֧ͼ⻻ܸоĲ
+*/
+unit32 CPZIndexDecrypt1_SSE2(unit32 *IndexBuff, unit32 Count, unit32 *IndexTable1, unit8 RorBit)
+{
+	unit32 Rotated[24];
+	__m128i Table[6];
+	for (unit32 i = 0; i < 24; i++)
+		Rotated[i] = IndexTable1[(5 + i) % 0x18];
+	for (unit32 i = 0; i < 6; i++)
+		Table[i] = _mm_loadu_si128((__m128i *)&Rotated[i * 4]);
+	__m128i Add1 = _mm_set1_epi32(0x784c5062);
+	__m128i Add2 = _mm_set1_epi32(0x1010101);
+	__m128i Right = _mm_cvtsi32_si128(RorBit);
+	__m128i Left = _mm_cvtsi32_si128(32 - RorBit);
+	unit32 i = 0, j = 0;
+	for (i = 0; i + 4 <= Count; i += 4)
+	{
+		__m128i x = _mm_loadu_si128((__m128i *)&IndexBuff[i]);
+		x = _mm_xor_si128(x, Table[j]);
+		x = _mm_add_epi32(x, Add1);
+		x = _mm_or_si128(_mm_srl_epi32(x, Right), _mm_sll_epi32(x, Left));
+		x = _mm_add_epi32(x, Add2);
+		_mm_storeu_si128((__m128i *)&IndexBuff[i], x);
+		if (++j == 6)
+			j = 0;
+	}
+	return i;
+}
+
 void CPZIndexDecrypt1(unit8 *Buff, unit32 IndexLength, unit32 IndexKey)
 {
-	unit32 *IndexTable1 = GetIndexTable1(IndexKey);
+	unit32 IndexTable1[24];
+	GetIndexTable1(IndexTable1, IndexKey);
 	unit8 RorBit = GetIndexRorBit1(IndexKey);
 	unit32 *IndexBuff = (unit32 *)Buff;
-	unit32 Flag = 5;
-	for (unit32 i = 0; i < IndexLength / 4; i++)
+	unit32 i = 0;
+	if (UseSSE2)
+		i = CPZIndexDecrypt1_SSE2(IndexBuff, IndexLength / 4, IndexTable1, RorBit);
+	unit32 Flag = (5 + i) % 0x18;
+	for (; i < IndexLength / 4; i++)
 	{
 		IndexBuff[i] ^= IndexTable1[(5 + i) % 0x18];
 		IndexBuff[i] += 0x784c5062;
@@ -207,9 +246,8 @@ void CPZIndexDecrypt1(unit8 *Buff, unit32 IndexLength, unit32 IndexKey)
 	}
 }
 
-unit8* GetByteTable2(unit32 Key, unit32 Seed)
+void GetByteTable2(unit8 *ByteTable, unit32 Key, unit32 Seed)
 {
-	unit8 ByteTable[0x100];
 	unit32 i = 0;
 	for (i = 0; i < 0x100; i++)
 		ByteTable[i] = i;
@@ -226,31 +264,58 @@ unit8* GetByteTable2(unit32 Key, unit32 Seed)
 		Key *= 0x1a74f195;
 		Key += Seed;
 	}
-	return ByteTable;
 }
 
+//ֽڲֱSSE2/AVX2ûֽgatherSSSE3pshufb4λ16ƴ256
+//ÿ16ֽҪ16pshufbӱȽϡϲʵ1MBݱȱԼɣֻĿ¼ô
 void CPZIndexDecrypt2(unit8 *IndexBuff, unit32 IndexLength, unit32 IndexKey, unit32 Seed)
 {
-	unit8 *ByteTable = GetByteTable2(IndexKey, Seed);
+	unit8 ByteTable[0x100];
+	GetByteTable2(ByteTable, IndexKey, Seed);
 	for (unit32 i = 0; i < IndexLength; i++)
 		IndexBuff[i] = ByteTable[IndexBuff[i] ^ 0x3a];
 }
 
-unit32* GetIndexKey3()
+void GetIndexKey3(unit32 *Key)
 {
-	unit32 Key[4];
 	Key[0] = CPZ_Header.Md5Data[0] ^ (CPZ_Header.IndexKey + 0x76a3bf29);
 	Key[1] = CPZ_Header.IndexKey ^ CPZ_Header.Md5Data[1];
 	Key[2] = CPZ_Header.Md5Data[2] ^ (CPZ_Header.IndexKey + 0x10000000);
 	Key[3] = CPZ_Header.IndexKey ^ CPZ_Header.Md5Data[3];
-	return Key;
+}
+
+//Seedÿdword̶0x10fb562a4·ʱÿּ4
+unit32 CPZIndexDecrypt3_SSE2(unit32 *IndexBuff, unit32 Count, unit32 *Key, unit32 Seed)
+{
+	__m128i k = _mm_loadu_si128((__m128i *)Key);
+	__m128i Sub = _mm_set1_epi32(0x4a91c262);
+	__m128i s = _mm_setr_epi32(Seed, Seed + 0x10fb562a, Seed + 0x10fb562a * 2, Seed + 0x10fb562a * 3);
+	__m128i Step = _mm_set1_epi32(0x10fb562a * 4);
+	unit32 i = 0;
+	for (i = 0; i + 4 <= Count; i += 4)
+	{
+		__m128i x = _mm_loadu_si128((__m128i *)&IndexBuff[i]);
+		x = _mm_xor_si128(x, k);
+		x = _mm_sub_epi32(x, Sub);
+		x = _mm_or_si128(_mm_slli_epi32(x, 3), _mm_srli_epi32(x, 29));
+		x = _mm_sub_epi32(x, s);
+		s = _mm_add_epi32(s, Step);
+		_mm_storeu_si128((__m128i *)&IndexBuff[i], x);
+	}
+	return i;
 }
 
 void CPZIndexDecrypt3(unit8 *Buff, unit32 IndexLength, unit32 *Key, unit32 Seed)
 {
 	unit32* IndexBuff = (unit32*)Buff;
-	unit32 Flag = 0;
-	for (unit32 i = 0; i<IndexLength / 4; i++)
+	unit32 i = 0;
+	if (UseSSE2)
+	{
+		i = CPZIndexDecrypt3_SSE2(IndexBuff, IndexLength / 4, Key, Seed);
+		Seed += 0x10fb562a * i;
+	}
+	unit32 Flag = i & 3;
+	for (; i<IndexLength / 4; i++)
 	{
 		IndexBuff[i] ^= Key[i & 3];
 		IndexBuff[i] -= 0x4a91c262;
@@ -269,31 +334,57 @@ void CPZIndexDecrypt3(unit8 *Buff, unit32 IndexLength, unit32 *Key, unit32 Seed)
 	}
 }
 
-unit32* GetFileIndexKey2(unit32 DirKey)
+void GetFileIndexKey2(unit32 *Key, unit32 DirKey)
 {
-	unit32 Key[4];
 	Key[0] = DirKey ^ CPZ_Header.Md5Data[0];
 	Key[2] = DirKey ^ CPZ_Header.Md5Data[2];
 	Key[1] = (DirKey + 0x11003322) ^ CPZ_Header.Md5Data[1];
 	DirKey += 0x34216785;
 	Key[3] = DirKey^CPZ_Header.Md5Data[3];
-	return Key;
 }
 
 void CPZFileIndexDecrypt1(unit8 *Buff, unit32 Length, unit32 Key, unit32 Seed)
 {
-	unit8 *ByteTable = GetByteTable2(Key, Seed);
+	unit8 ByteTable[0x100];
+	GetByteTable2(ByteTable, Key, Seed);
 	for (unit32 i = 0; i < Length; i++)
 		Buff[i] = ByteTable[Buff[i] ^ 0x7e];
 }
 
+unit32 CPZFileIndexDecrypt2_SSE2(unit32 *Buff, unit32 Count, unit32 *FileIndexKey)
+{
+	__m128i k = _mm_loadu_si128((__m128i *)FileIndexKey);
+	__m128i Add = _mm_set1_epi32(0x37a19e8b);
+	__m128i s = _mm_setr_epi32(0x2a65cb4f, 0x2a65cb4f - 0x139fa9b, 0x2a65cb4f - 0x139fa9b * 2, 0x2a65cb4f - 0x139fa9b * 3);
+	__m128i Step = _mm_set1_epi32(0x139fa9b * 4);
+	unit32 i = 0;
+	for (i = 0; i + 4 <= Count; i += 4)
+	{
+		__m128i x = _mm_loadu_si128((__m128i *)&Buff[i]);
+		x = _mm_xor_si128(x, k);
+		x = _mm_sub_epi32(x, s);
+		x = _mm_or_si128(_mm_slli_epi32(x, 2), _mm_srli_epi32(x, 30));
+		x = _mm_add_epi32(x, Add);
+		s = _mm_sub_epi32(s, Step);
+		_mm_storeu_si128((__m128i *)&Buff[i], x);
+	}
+	return i;
+}
+
 void CPZFileIndexDecrypt2(unit8 *FileIndexBuff, unit32 Length, unit32 DirKey)
 {
-	unit32 *FileIndexKey = GetFileIndexKey2(DirKey);
+	unit32 FileIndexKey[4];
+	GetFileIndexKey2(FileIndexKey, DirKey);
 	unit32 *Buff = (unit32 *)FileIndexBuff;
 	unit32 Seed = 0x2a65cb4f;
-	unit32 Flag = 0;
-	for (unit32 i = 0; i < Length / 4; i++)
+	unit32 i = 0;
+	if (UseSSE2)
+	{
+		i = CPZFileIndexDecrypt2_SSE2(Buff, Length / 4, FileIndexKey);
+		Seed -= 0x139fa9b * i;
+	}
+	unit32 Flag = i & 3;
+	for (; i < Length / 4; i++)
 	{
 		Buff[i] ^= FileIndexKey[i & 3];
 		Buff[i] -= Seed;
@@ -382,14 +473,85 @@ void ReadFileIndex(unit8 *data)
 	}
 }
 
-unit8* ReadIndex(FILE *src)
+typedef struct cpz_map
+{
+	HANDLE File;
+	HANDLE Mapping;
+	unit64 Size;
+	unit8 *Base;//ļֻӳ䣬32λµַռ䲻ʱΪNULLʱΪӳ䴰
+	unit32 Granularity;
+}CPZ_Map;
+
+BOOL OpenCPZMap(CPZ_Map *m, char *fname)
+{
+	LARGE_INTEGER size;
+	SYSTEM_INFO info;
+	m->Base = NULL;
+	m->File = CreateFileA(fname, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (m->File == INVALID_HANDLE_VALUE)
+		return FALSE;
+	GetFileSizeEx(m->File, &size);
+	m->Size = size.QuadPart;
+	//PAGE_WRITECOPYӳֻܿͼҲܿFILE_MAP_COPYͼԭؽܶдļ
+	m->Mapping = CreateFileMappingA(m->File, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	if (!m->Mapping)
+	{
+		CloseHandle(m->File);
+		return FALSE;
+	}
+	GetSystemInfo(&info);
+	m->Granularity = info.dwAllocationGranularity;
+	m->Base = MapViewOfFile(m->Mapping, FILE_MAP_READ, 0, 0, 0);
+	return TRUE;
+}
+
+unit8* MapCPZView(CPZ_Map *m, unit64 offset, unit32 length, DWORD access, LPVOID *view)
+{
+	*view = NULL;
+	//ʱoffsetlengthܳļֱӷNULLɵ
+	if (offset > m->Size || length > m->Size - offset)
+		return NULL;
+	if (m->Base && access == FILE_MAP_READ)
+		return m->Base + offset;
+	//ͼ밴ȶ
+	unit64 start = offset - offset % m->Granularity;
+	*view = MapViewOfFile(m->Mapping, access, (DWORD)(start >> 32), (DWORD)start, (SIZE_T)(offset - start + length));
+	if (!*view)
+		return NULL;
+	return (unit8 *)*view + (offset - start);
+}
+
+void UnmapCPZView(LPVOID view)
+{
+	if (view)
+		UnmapViewOfFile(view);
+}
+
+void CloseCPZMap(CPZ_Map *m)
+{
+	if (m->Base)
+		UnmapViewOfFile(m->Base);
+	CloseHandle(m->Mapping);
+	CloseHandle(m->File);
+}
+
+unit8* ReadIndex(CPZ_Map *m, LPVOID *IndexView)
 {
 	unit32 IndexSize = 0, i = 0;
 	unit8 *data, *index_key;
-	fread(&CPZ_Header, sizeof(CPZ_Header), 1, src);
+	LPVOID view;
+	if (m->Size < sizeof(CPZ_Header))
+	{
+		CloseCPZMap(m);
+		printf("ļͷCPZ7\n");
+		system("pause");
+		exit(0);
+	}
+	memcpy(&CPZ_Header, MapCPZView(m, 0, sizeof(CPZ_Header), FILE_MAP_READ, &view), sizeof(CPZ_Header));
+	UnmapCPZView(view);
 	if (CPZ_Header.Magic != 0x375A5043)
 	{
-		fclose(src);
+		CloseCPZMap(m);
 		printf("ļͷCPZ7\n");
 		system("pause");
 		exit(0);
@@ -403,8 +565,14 @@ unit8* ReadIndex(FILE *src)
 	}
 	CPZHeaderDecrypt();
 	IndexSize = CPZ_Header.DirIndexLength + CPZ_Header.FileIndexLength + CPZ_Header.IndexKeySize;
-	data = malloc(IndexSize);
-	fread(data, IndexSize, 1, src);
+	//ֱдʱͼԭؽܣٵ
+	data = MapCPZView(m, sizeof(CPZ_Header), IndexSize, FILE_MAP_COPY, IndexView);
+	if (!data || m->Size < sizeof(CPZ_Header) + (unit64)IndexSize)
+	{
+		printf("֤ͨǷ𻵻ǲֵ֧ļ͡\n");
+		system("pause");
+		exit(0);
+	}
 	if (!IndexVerify(data, IndexSize))
 	{
 		printf("֤ͨǷ𻵻ǲֵ֧ļ͡\n");
@@ -417,7 +585,8 @@ unit8* ReadIndex(FILE *src)
 	free(index_key);
 	CPZIndexDecrypt1(data, CPZ_Header.DirIndexLength + CPZ_Header.FileIndexLength, CPZ_Header.IndexKey);
 	CPZIndexDecrypt2(data, CPZ_Header.DirIndexLength, CPZ_Header.IndexKey, CPZ_Header.Md5Data[1]);
-	unit32 *Key = GetIndexKey3();
+	unit32 Key[4];
+	GetIndexKey3(Key);
 	CPZIndexDecrypt3(data, CPZ_Header.DirIndexLength, Key, 0x76548aef);
 	unit8 version = 0;
 	memcpy(&version, (unit8*)&CPZ_Header + 3, 1);
@@ -425,81 +594,273 @@ unit8* ReadIndex(FILE *src)
 	return data;
 }
 
-void CPZResourceDecrypt(unit8 *FileBuff, unit32 Length, unit32 IndexKey, unit32 *Md5Data, unit32 Seed)
+typedef struct cpz_key_ctx
 {
-	unit32 DecryptKey[32];
+	unit32 Md5Data[4];
+	unit8 ByteTable[0x100];//GetByteTable2(Md5Data[3], IndexKey)ֻļͷйأֻһ
+	unit8 ByteTableInv[0x100];//ByteTableʱֽڱ
+	unit32 BaseKey[16];//δSeedļԿԭDecryptKey[32]ʵֻõǰ16dword
+}CPZ_Key_Ctx;
+CPZ_Key_Ctx CPZ_Key;
+
+void InitCPZKeyCtx(CPZ_Key_Ctx *ctx, unit32 IndexKey, unit32 *Md5Data)
+{
+	unit8 *p = (unit8 *)ctx->BaseKey;
+	unit8 Key = (unit8)(Md5Data[1] >> 2);
+	memcpy(ctx->Md5Data, Md5Data, sizeof(ctx->Md5Data));
+	GetByteTable2(ctx->ByteTable, Md5Data[3], IndexKey);
+	for (unit32 i = 0; i < 0x100; i++)
+		ctx->ByteTableInv[ctx->ByteTable[i]] = i;
+	for (unit32 i = 0; i < sizeof(ctx->BaseKey); i++)
+		p[i] = Key ^ ctx->ByteTable[ByteString[i]];
+}
+
+void CPZResourceDecrypt(CPZ_Key_Ctx *ctx, unit8 *FileBuff, unit8 *SrcBuff, unit32 Length, unit32 Seed)
+{
+	unit32 DecryptKey[16];
 	unit32 *Buff = (unit32 *)FileBuff;
-	unit32 Key = Md5Data[1] >> 2;
-	unit8 *ByteTable = GetByteTable2(Md5Data[3], IndexKey);
-	unit8 *p = (unit8 *)DecryptKey;
-	for (unit32 i = 0; i < 96; i++)
-		p[i] = (unit8)Key ^ ByteTable[ByteString[i] & 0xff];
-	for (unit32 i = 0; i < 24; i++)
-		DecryptKey[i] ^= Seed;
-	Key = 0x2748c39e;
+	unit32 *Src = (unit32 *)SrcBuff;
+	for (unit32 i = 0; i < 16; i++)
+		DecryptKey[i] = ctx->BaseKey[i] ^ Seed;
+	unit32 Key = 0x2748c39e;
 	unit32 Flag = 0x0a;
 	for (unit32 i = 0; i < Length / 4; i++)
 	{
 		unit32 Temp = DecryptKey[Flag];
 		Temp >>= 1;
 		Temp ^= DecryptKey[(Key >> 6) & 0xf];
-		Temp ^= Buff[i];
+		Temp ^= Src[i];
 		Temp -= Seed;
-		Temp ^= Md5Data[Key & 3];
+		Temp ^= ctx->Md5Data[Key & 3];
 		Buff[i] = Temp;
 		Key = Key + Seed + Buff[i];
 		Flag++;
 		Flag &= 0xf;
 	}
 	for (unit32 i = Length / 4 * 4; i < Length; i++)
-		FileBuff[i] = ByteTable[FileBuff[i] ^ 0xae];
+		FileBuff[i] = ctx->ByteTable[SrcBuff[i] ^ 0xae];
 }
 
-void UnpackFile(char* fname)
+typedef struct cpz_unpack_task
+{
+	NodeCPZ_Dir_Index *dir;
+	NodeCPZ_File_Index *file;
+}CPZ_Unpack_Task;
+CPZ_Unpack_Task *CPZ_Task = NULL;
+volatile LONG TaskCursor = 0;//һţ߳ԭӵȡ
+CPZ_Map Map;
+struct _utimbuf ArcTime;//ļͳһʹ÷޸ʱ䣬CPZ7_packģʽݴжļǷ񱻸Ķ
+unit64 ResourceOffset = 0;
+
+DWORD WINAPI UnpackThread(LPVOID param)
 {
-	FILE *src, *dst;
-	src = fopen(fname, "rb");
-	unit8 *data = ReadIndex(src);
+	FILE *dst;
+	LPVOID view;
+	unit8 *data = NULL, *src;
+	unit32 buff_size = 0;
+	wchar_t filename[MAX_PATH];
+	//̹߳ͬһӳ䣬ֻȡԼĿͼ
+	while (TRUE)
+	{
+		LONG n = InterlockedIncrement(&TaskCursor) - 1;
+		if ((unit32)n >= FileNum)
+			break;
+		NodeCPZ_Dir_Index *q = CPZ_Task[n].dir;
+		NodeCPZ_File_Index *p = CPZ_Task[n].file;
+		wprintf(L"\t%s offset:0x%llX size:0x%llX file_key:0x%X crc:0x%X\n", p->FileName, p->Offset, p->Length, p->FileKey, p->CRC);
+		wsprintfW(filename, L"%ls/%ls", q->DirName, p->FileName);
+		//ԴֱӴӳͼ̸ܵ߳õδʱԭӳд
+		//ļȻڴﴦ4GBļ
+		if (p->Length > 0xFFFFFFFF)
+		{
+			wprintf(L"\tļ%ls\n", filename);
+			continue;
+		}
+		src = p->Length ? MapCPZView(&Map, ResourceOffset + p->Offset, (unit32)p->Length, FILE_MAP_READ, &view) : NULL;
+		if (p->Length && !src)
+		{
+			wprintf(L"\tݳΧӳʧܣ%ls\n", filename);
+			continue;
+		}
+		dst = _wfopen(filename, L"wb");
+		if (src)
+		{
+			if (CPZ_Header.IsEncrypt)
+			{
+				if (p->Length > buff_size)
+				{
+					free(data);
+					buff_size = (unit32)p->Length;
+					data = malloc(buff_size);
+				}
+				CPZResourceDecrypt(&CPZ_Key, data, src, (unit32)p->Length, CPZ_Header.IndexSeed ^ ((CPZ_Header.IndexKey ^ (q->DirKey + p->FileKey)) + CPZ_Header.DirCount + 0xa3c61785));
+				fwrite(data, p->Length, 1, dst);
+			}
+			else
+				fwrite(src, p->Length, 1, dst);
+			UnmapCPZView(view);
+		}
+		fclose(dst);
+		_wutime(filename, &ArcTime);
+	}
+	free(data);
+	return 0;
+}
+
+void UnpackFile(char* fname, unit32 ThreadNum)
+{
+	LPVOID view;
+	struct _stat64 ArcStat;
+	if (!OpenCPZMap(&Map, fname))
+	{
+		printf("޷ļ%s\n", fname);
+		system("pause");
+		exit(0);
+	}
+	unit8 *data = ReadIndex(&Map, &view);
+	InitCPZKeyCtx(&CPZ_Key, CPZ_Header.IndexKey, CPZ_Header.Md5Data);
 	ReadDirIndex(data);
 	ReadFileIndex(data);
-	free(data);
+	UnmapCPZView(view);
+	ResourceOffset = sizeof(CPZ_Header) + CPZ_Header.DirIndexLength + CPZ_Header.FileIndexLength + CPZ_Header.IndexKeySize;
+	_stat64(fname, &ArcStat);
+	ArcTime.actime = ArcStat.st_mtime;
+	ArcTime.modtime = ArcStat.st_mtime;
 	unit8 dirname[MAX_PATH];
-	wchar_t filename[MAX_PATH];
 	sprintf(dirname, "%s_unpack", fname);
 	_mkdir(dirname);
 	_chdir(dirname);
+	//ȽĿ¼ļչ֮Ķȡܡд̳߳
+	CPZ_Task = malloc(sizeof(CPZ_Unpack_Task) * (FileNum ? FileNum : 1));
+	unit32 n = 0;
 	NodeCPZ_Dir_Index *q = CPZ_Dir_Index;
 	while (q->next)
 	{
 		q = q->next;
 		wprintf(L"dirname:%ls file_num:%d file_index_offset:0x%X file_index_len:0x%X dir_key:0x%X\n", q->DirName, q->FileCount, q->FileIndexOffset, q->FileIndexLength, q->DirKey);
-		NodeCPZ_File_Index *p = q->file_index;
 		_wmkdir(q->DirName);
+		NodeCPZ_File_Index *p = q->file_index;
 		while (p)
 		{
-			wprintf(L"\t%s offset:0x%X size:0x%X file_key:0x%X crc:0x%X\n", p->FileName, p->Offset, p->Length, p->FileKey, p->CRC);
-			wsprintfW(filename, L"%ls/%ls", q->DirName, p->FileName);
-			fseek(src, p->Offset + sizeof(CPZ_Header) + CPZ_Header.DirIndexLength + CPZ_Header.FileIndexLength + CPZ_Header.IndexKeySize, SEEK_SET);
-			data = malloc(p->Length);
-			fread(data, p->Length, 1, src);
-			if (CPZ_Header.IsEncrypt)
-				CPZResourceDecrypt(data, p->Length, CPZ_Header.IndexKey, CPZ_Header.Md5Data, CPZ_Header.IndexSeed ^ ((CPZ_Header.IndexKey ^ (q->DirKey + p->FileKey)) + CPZ_Header.DirCount + 0xa3c61785));
-			dst = _wfopen(filename, L"wb");
-			fwrite(data, p->Length, 1, dst);
-			fclose(dst);
-			free(data);
+			CPZ_Task[n].dir = q;
+			CPZ_Task[n].file = p;
+			n++;
 			p = p->next;
 		}
 	}
-	fclose(src);
+	if (ThreadNum == 0)
+	{
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		ThreadNum = info.dwNumberOfProcessors;
+	}
+	if (ThreadNum > MAXIMUM_WAIT_OBJECTS)
+		ThreadNum = MAXIMUM_WAIT_OBJECTS;
+	if (ThreadNum > FileNum)
+		ThreadNum = FileNum ? FileNum : 1;
+	printf("\nthread_num:%d\n\n", ThreadNum);
+	HANDLE *Threads = malloc(sizeof(HANDLE) * ThreadNum);
+	for (unit32 i = 0; i < ThreadNum; i++)
+		Threads[i] = CreateThread(NULL, 0, UnpackThread, NULL, 0, NULL);
+	WaitForMultipleObjects(ThreadNum, Threads, TRUE, INFINITE);
+	for (unit32 i = 0; i < ThreadNum; i++)
+		CloseHandle(Threads[i]);
+	free(Threads);
+	free(CPZ_Task);
+	CloseCPZMap(&Map);
+}
+
+//-selftestͬһݷֱ߱SSE2·ֽ߽һ
+//ȸ0~10274dwordͲ4ıβʼַ0~3ֽڸǷǶд
+void RunCPZKernel(unit32 Kernel, unit8 *Buff, unit32 Length, unit32 *Key, unit32 IndexKey, unit32 Seed, CPZ_Key_Ctx *ctx)
+{
+	switch (Kernel)
+	{
+	case 0:
+		CPZIndexDecrypt1(Buff, Length, IndexKey);
+		break;
+	case 1:
+		CPZIndexDecrypt2(Buff, Length, IndexKey, Seed);
+		break;
+	case 2:
+		CPZIndexDecrypt3(Buff, Length, Key, Seed);
+		break;
+	case 3:
+		CPZFileIndexDecrypt1(Buff, Length, IndexKey, Seed);
+		break;
+	case 4:
+		CPZFileIndexDecrypt2(Buff, Length, IndexKey);
+		break;
+	default:
+		CPZResourceDecrypt(ctx, Buff, Buff, Length, Seed);
+		break;
+	}
+}
+
+unit32 Rand32()
+{
+	return ((unit32)rand() << 30) ^ ((unit32)rand() << 15) ^ (unit32)rand();
+}
+
+BOOL SelfTestSSE2()
+{
+	char *KernelName[6] = { "CPZIndexDecrypt1", "CPZIndexDecrypt2", "CPZIndexDecrypt3", "CPZFileIndexDecrypt1", "CPZFileIndexDecrypt2", "CPZResourceDecrypt" };
+	unit8 Src[1031], Ref[1031], Out[1031];
+	unit32 Key[4], Fail = 0;
+	CPZ_Key_Ctx ctx;
+	if (!UseSSE2)
+	{
+		printf("CPU֧SSE2ֻб·ҪԼ\n");
+		return TRUE;
+	}
+	srand(GetTickCount());
+	for (unit32 Round = 0; Round < 16; Round++)
+	{
+		for (unit32 Length = 0; Length < 1028; Length++)
+		{
+			unit32 Align = (Length + Round) & 3;
+			unit32 IndexKey = Rand32(), Seed = Rand32();
+			for (unit32 i = 0; i < 4; i++)
+			{
+				Key[i] = Rand32();
+				CPZ_Header.Md5Data[i] = Rand32();
+			}
+			for (unit32 i = 0; i < sizeof(Src); i++)
+				Src[i] = rand();
+			InitCPZKeyCtx(&ctx, IndexKey, CPZ_Header.Md5Data);
+			for (unit32 Kernel = 0; Kernel < 6; Kernel++)
+			{
+				memcpy(Ref, Src, sizeof(Src));
+				memcpy(Out, Src, sizeof(Src));
+				UseSSE2 = FALSE;
+				RunCPZKernel(Kernel, Ref + Align, Length, Key, IndexKey, Seed, &ctx);
+				UseSSE2 = TRUE;
+				RunCPZKernel(Kernel, Out + Align, Length, Key, IndexKey, Seed, &ctx);
+				//һȽϣԽдҲܲ
+				if (memcmp(Ref, Out, sizeof(Src)) != 0)
+				{
+					printf("%sһ len:%d align:%d\n", KernelName[Kernel], Length, Align);
+					Fail++;
+				}
+			}
+		}
+	}
+	return Fail == 0;
 }
 
 int main(int argc, char *argv[])
 {
 	setlocale(LC_ALL, "chs");
-	printf("projectNiflheim-cmvs\nڽļͷΪCPZ7cpzļ\ncpzļϵϡ\nby Darkness-TX 2018.04.19\n\n");
-	UnpackFile(argv[1]);
+	UseSSE2 = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+	printf("projectNiflheim-cmvs\nڽļͷΪCPZ7cpzļ\ncpzļϵϡ\nΪ-selftestʱSSE2·ĽܽǷһ¡\nѡڶָ߳ĬΪCPU\nby Darkness-TX 2018.04.19\n\n");
+	if (argc > 1 && strcmp(argv[1], "-selftest") == 0)
+	{
+		printf(SelfTestSSE2() ? "Լͨ\n" : "Լʧ\n");
+		system("pause");
+		return 0;
+	}
+	UnpackFile(argv[1], argc > 2 ? atoi(argv[2]) : 0);
 	printf("ɣļ%d\n", FileNum);
 	system("pause");
 	return 0;
-}
\ No newline at end of file
+}
@@ -12,6 +12,7 @@ made by Darkness-TX
 #include <Windows.h>
 #include <locale.h>
 #include <png.h>
+#include <emmintrin.h>
 
 typedef unsigned char  unit8;
 typedef unsigned short unit16;
@@ -19,12 +20,19 @@ typedef unsigned int   unit32;
 typedef unsigned __int64 unit64;
 
 unit32 FileNum = 0;//ļʼΪ0
+unit32 IndexCap = 0;//Indexǰʱ
+volatile LONG TaskCursor = 0;//һתļţ߳ԭӵȡ
+volatile LONG FailNum = 0;//תʧܵļ߳ﲻͣȫͳһ
+BOOL UseSSE2 = FALSE;//ʱ⣬֧ʱԭıDctYcc2Rgb
+unit8 ClampTable[0x10000];//Ycc2Rgbıͱ0x300Ҳ0xFFԽ
+unit8 ReverseTable[0x100];//ֽڱطת
+#define HUFF_LUT_BITS 10 //Ȱ10λ
 
 struct index
 {
-	WCHAR FileName[MAX_PATH];//ļ
+	WCHAR *FileName;//ļ
 	unit32 FileSize;//ļС
-}Index[50000];
+}*Index = NULL;
 
 struct jbp_header
 {
@@ -40,7 +48,7 @@ struct jbp_header
 	unit32 ac_bits;
 	unit32 unk2;
 	unit32 unk3;
-}JBP_Header;
+};
 
 struct pb3_header
 {
@@ -59,9 +67,44 @@ struct pb3_header
 	unit32 unk5;
 	unit32 data_off;//v6jbpv1,jbpʱΪalpha_off
 	unit32 alpha_size;//jbpʱ,v1ĿԵdata_off2
-}PB3_Header;
+};
 
-unit8 frame[0x800];
+//ÿ߳һݵĽ뻺壬ֻͼƬ
+enum
+{
+	BUFF_FILE,//pb3ļ
+	BUFF_BASE_FILE,//v6basepicļ
+	BUFF_OUT,//أһɰBGRAÿ4ֽ
+	BUFF_PLANE,//v1Ľѹƽ桢v6Ĳݡjbpdcϵ
+	BUFF_NUM
+};
+
+typedef struct pb3_ctx
+{
+	unit8 *Buff[BUFF_NUM];
+	unit32 BuffSize[BUFF_NUM];
+	unit32 Stride;//BUFF_OUTпjbpʱĿȼ
+	unit8 frame[0x800];
+	unit32 DctTable[6][64];
+}PB3_Ctx;
+
+unit8* GetBuff(PB3_Ctx *ctx, unit32 slot, unit32 size)
+{
+	if (ctx->BuffSize[slot] < size)
+	{
+		free(ctx->Buff[slot]);
+		ctx->Buff[slot] = malloc(size);
+		ctx->BuffSize[slot] = size;
+	}
+	return ctx->Buff[slot];
+}
+
+void FreePB3Ctx(PB3_Ctx *ctx)
+{
+	for (unit32 i = 0; i < BUFF_NUM; i++)
+		free(ctx->Buff[i]);
+	free(ctx);
+}
 
 unit32 process_dir(char *dname)
 {
@@ -78,100 +121,103 @@ unit32 process_dir(char *dname)
 	{
 		if (FileInfo.name[0] == L'.')  //˱Ŀ¼͸Ŀ¼
 			continue;
-		wsprintf(Index[FileNum].FileName, FileInfo.name);
+		if (FileNum == IndexCap)
+		{
+			IndexCap = IndexCap ? IndexCap * 2 : 0x100;
+			Index = realloc(Index, sizeof(struct index) * IndexCap);
+		}
+		Index[FileNum].FileName = _wcsdup(FileInfo.name);
 		Index[FileNum].FileSize = FileInfo.size;
 		FileNum++;
 	} while (_wfindnext(Handle, &FileInfo) == 0);
+	_findclose(Handle);
 	return FileNum;
 }
 
-void decrypt_header(FILE *src, struct pb3_header *PB3)
+//ļslotӦĻ壬ĩβ0x10ֽڵ0ֹͷ
+unit8* LoadFile(PB3_Ctx *ctx, unit32 slot, WCHAR *fname, unit32 *size)
+{
+	FILE *src = _wfopen(fname, L"rb");
+	if (src == NULL)
+		return NULL;
+	fseek(src, 0, SEEK_END);
+	*size = ftell(src);
+	fseek(src, 0, SEEK_SET);
+	unit8 *data = GetBuff(ctx, slot, *size + 0x10);
+	fread(data, *size, 1, src);
+	memset(data + *size, 0, 0x10);
+	fclose(src);
+	return data;
+}
+
+void decrypt_header(unit8 *file, unit32 filesize, struct pb3_header *PB3)
 {
 	unit16 key = 0, i = 0;
 	unit8 *p = (unit8 *)PB3, *key_data = NULL;
-	unit32 filesize = 0;
-	fseek(src, 0, SEEK_END);
-	filesize = ftell(src);
-	fseek(src, filesize - 3, SEEK_SET);
-	fread(&key, 2, 1, src);
+	key = *(unit16 *)&file[filesize - 3];
 	for (i = 8; i < 0x34; i += 2)
 		*(unit16 *)&p[i] ^= key;
-	fseek(src, filesize - 0x2F, SEEK_SET);
-	key_data = malloc(0x34 - 8);
-	fread(key_data, 0x34 - 8, 1, src);
+	key_data = file + filesize - 0x2F;
 	for (i = 8; i < 0x34; i++)
 		p[i] -= key_data[i - 8];
-	free(key_data);
-	fseek(src, PB3->headsize, SEEK_SET);
 	p = NULL;
 }
 
-void ReadIndex(FILE *src, struct pb3_header *PB3)
+BOOL ReadIndex(unit8 *file, unit32 filesize, struct pb3_header *PB3)
 {
-	fread(PB3, sizeof(PB3_Header), 1, src);
-	if (strncmp(PB3->sign, "PB3B", 4))
+	if (filesize < sizeof(struct pb3_header) || strncmp(file, "PB3B", 4))
 	{
 		wprintf(L"ֵ֧ļͣļͷPB3B\n");
-		system("pause");
-		exit(0);
+		return FALSE;
 	}
-	decrypt_header(src, PB3);
+	memcpy(PB3, file, sizeof(struct pb3_header));
+	decrypt_header(file, filesize, PB3);
+	return TRUE;
 }
 
-void WritePng(FILE *Pngname, unit32 Width, unit32 Height, unit32 Bpp, unit8* data)
+//dataһÿ4ֽڵBGR(A)libpngдʱRGB˳24λʱ4ֽڣʡͼ
+BOOL WritePng(FILE *Pngname, unit32 Width, unit32 Height, unit32 Bpp, unit32 Stride, unit8* data)
 {
 	png_structp png_ptr;
 	png_infop info_ptr;
 	unit32 i = 0;
-	unit8 buff = 0;
 	png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
 	if (png_ptr == NULL)
 	{
 		printf("PNGϢʧ!\n");
-		exit(0);
+		return FALSE;
 	}
 	info_ptr = png_create_info_struct(png_ptr);
 	if (info_ptr == NULL)
 	{
 		printf("infoϢʧ!\n");
 		png_destroy_write_struct(&png_ptr, (png_infopp)NULL);
-		exit(0);
+		return FALSE;
 	}
 	png_init_io(png_ptr, Pngname);
 	if (Bpp == 24)
 	{
 		png_set_IHDR(png_ptr, info_ptr, Width, Height, 8, PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
 		png_write_info(png_ptr, info_ptr);
-		for (i = 0; i < Width * Height; i++)
-		{
-			buff = data[i * 3 + 0];
-			data[i * 3 + 0] = data[i * 3 + 2];
-			data[i * 3 + 2] = buff;
-		}
-		for (i = 0; i < Height; i++)
-			png_write_row(png_ptr, data + i*Width * 3);
+		png_set_filler(png_ptr, 0, PNG_FILLER_AFTER);
 	}
 	else if (Bpp == 32)
 	{
 		png_set_IHDR(png_ptr, info_ptr, Width, Height, 8, PNG_COLOR_TYPE_RGB_ALPHA, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
 		png_write_info(png_ptr, info_ptr);
-		for (i = 0; i < Width * Height; i++)
-		{
-			buff = data[i * 4 + 0];
-			data[i * 4 + 0] = data[i * 4 + 2];
-			data[i * 4 + 2] = buff;
-		}
-		for (i = 0; i < Height; i++)
-			png_write_row(png_ptr, data + i*Width * 4);
 	}
 	else
 	{
-		printf("ֵ֧bppģʽ!");
-		system("pause");
-		exit(0);
+		printf("ֵ֧bppģʽ!\n");
+		png_destroy_write_struct(&png_ptr, &info_ptr);
+		return FALSE;
 	}
+	png_set_bgr(png_ptr);
+	for (i = 0; i < Height; i++)
+		png_write_row(png_ptr, data + i * Stride);
 	png_write_end(png_ptr, info_ptr);
 	png_destroy_write_struct(&png_ptr, &info_ptr);
+	return TRUE;
 }
 
 unit32 HuffmanTree(unit32 *freq, unit32 *Nodes)
@@ -301,14 +347,8 @@ void Dct(unit32 *dct_table, unit16 *quant)
 
 void Ycc2Rgb(unit32 dc, unit32 ac, unit32 *dct_y, unit32 *dct_cb, unit32 *dct_cr, unit32 cbcr_src, unit32 stride, unit8 *data)
 {
-	unit32 y_src = 0, n = 0;
-	unit8 Table[0x300];
-	for (n = 0; n < 0x100; n++)
-		Table[n] = 0;
-	for (n = 0; n < 0x100; n++)
-		Table[n + 0x100] = n;
-	for (n = 0; n < 0x100; n++)
-		Table[n + 0x200] = 0xFF;
+	unit32 y_src = 0;
+	unit8 *Table = ClampTable;
 	for (unit32 y = 0; y < 4; ++y)
 	{
 		for (unit32 x = 0; x < 4; ++x)
@@ -346,6 +386,173 @@ void Ycc2Rgb(unit32 dc, unit32 ac, unit32 *dct_y, unit32 *dct_cb, unit32 *dct_cr
 	}
 }
 
+//SSE2û32λ˷ȡλ_mm_mul_epu32ƴͱһ
+__m128i MulLo32(__m128i a, __m128i b)
+{
+	__m128i lo = _mm_mul_epu32(a, b);
+	__m128i hi = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(lo, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(hi, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+__m128i MulShr16(__m128i x, int k)
+{
+	return _mm_srai_epi32(MulLo32(x, _mm_set1_epi32(k)), 16);
+}
+
+//سshortٷչӦ(short)
+__m128i ToShort32(__m128i x)
+{
+	return _mm_srai_epi32(_mm_slli_epi32(x, 16), 16);
+}
+
+void Transpose4_SSE2(__m128i *m)
+{
+	__m128i t0 = _mm_unpacklo_epi32(m[0], m[1]);
+	__m128i t1 = _mm_unpacklo_epi32(m[2], m[3]);
+	__m128i t2 = _mm_unpackhi_epi32(m[0], m[1]);
+	__m128i t3 = _mm_unpackhi_epi32(m[2], m[3]);
+	m[0] = _mm_unpacklo_epi64(t0, t1);
+	m[1] = _mm_unpackhi_epi64(t0, t1);
+	m[2] = _mm_unpacklo_epi64(t2, t3);
+	m[3] = _mm_unpackhi_epi64(t2, t3);
+}
+
+//Dctһά任Ӧ4·ͬʱ
+void Idct8_SSE2(__m128i *in, __m128i *out)
+{
+	__m128i a, b, c, d, w, x, y, z, s, t, u, v, n;
+	c = in[2];
+	d = in[6];
+	x = MulShr16(_mm_add_epi32(c, d), 35467);
+	c = _mm_add_epi32(MulShr16(c, 50159), x);
+	d = _mm_add_epi32(MulShr16(d, -121094), x);
+	a = in[0];
+	b = in[4];
+	w = _mm_add_epi32(_mm_add_epi32(a, b), c);
+	x = _mm_sub_epi32(_mm_add_epi32(a, b), c);
+	y = _mm_add_epi32(_mm_sub_epi32(a, b), d);
+	z = _mm_sub_epi32(_mm_sub_epi32(a, b), d);
+	c = in[7];
+	d = in[5];
+	a = in[3];
+	b = in[1];
+	__m128i ca = MulShr16(_mm_add_epi32(c, a), -128553);
+	__m128i cb = MulShr16(_mm_add_epi32(c, b), -58980);
+	__m128i db = MulShr16(_mm_add_epi32(d, b), -25570);
+	__m128i da = MulShr16(_mm_add_epi32(d, a), -167963);
+	n = MulShr16(_mm_add_epi32(_mm_add_epi32(a, b), _mm_add_epi32(c, d)), 77062);
+	u = _mm_add_epi32(_mm_add_epi32(n, MulShr16(c, 19571)), _mm_add_epi32(ca, cb));
+	v = _mm_add_epi32(_mm_add_epi32(n, MulShr16(d, 134553)), _mm_add_epi32(db, da));
+	t = _mm_add_epi32(_mm_add_epi32(n, MulShr16(b, 98390)), _mm_add_epi32(db, cb));
+	s = _mm_add_epi32(_mm_add_epi32(n, MulShr16(a, 201373)), _mm_add_epi32(ca, da));
+	out[0] = _mm_add_epi32(w, t);
+	out[7] = _mm_sub_epi32(w, t);
+	out[1] = _mm_add_epi32(y, s);
+	out[6] = _mm_sub_epi32(y, s);
+	out[2] = _mm_add_epi32(z, v);
+	out[5] = _mm_sub_epi32(z, v);
+	out[3] = _mm_add_epi32(x, u);
+	out[4] = _mm_sub_epi32(x, u);
+}
+
+/*
+Dctλһ¡
+б任һ4УACΪ0İĽݾֻȡDCֵѡб任תãͬ4һ㣬תûȥ
+*/
+void Dct_SSE2(unit32 *dct_table, unit16 *quant)
+{
+	__m128i in[8], out[8], zero = _mm_setzero_si128();
+	for (unit32 col = 0; col < 8; col += 4)
+	{
+		__m128i ac = zero;
+		for (unit32 i = 0; i < 8; i++)
+		{
+			in[i] = _mm_loadu_si128((__m128i *)&dct_table[i * 8 + col]);
+			if (i)
+				ac = _mm_or_si128(ac, in[i]);
+			in[i] = MulLo32(in[i], _mm_unpacklo_epi16(_mm_loadl_epi64((__m128i *)&quant[i * 8 + col]), zero));
+		}
+		__m128i dc_only = _mm_cmpeq_epi32(ac, zero);
+		__m128i dc = _mm_and_si128(dc_only, in[0]);
+		if (_mm_movemask_epi8(dc_only) == 0xFFFF)
+		{
+			//Ƶ4ȫΪ0ֱܳDC
+			for (unit32 i = 0; i < 8; i++)
+				_mm_storeu_si128((__m128i *)&dct_table[i * 8 + col], dc);
+			continue;
+		}
+		Idct8_SSE2(in, out);
+		for (unit32 i = 0; i < 8; i++)
+			_mm_storeu_si128((__m128i *)&dct_table[i * 8 + col], _mm_or_si128(dc, _mm_andnot_si128(dc_only, ToShort32(out[i]))));
+	}
+	for (unit32 row = 0; row < 8; row += 4)
+	{
+		for (unit32 i = 0; i < 4; i++)
+		{
+			in[i] = _mm_loadu_si128((__m128i *)&dct_table[(row + i) * 8]);
+			in[i + 4] = _mm_loadu_si128((__m128i *)&dct_table[(row + i) * 8 + 4]);
+		}
+		Transpose4_SSE2(in);
+		Transpose4_SSE2(in + 4);
+		Idct8_SSE2(in, out);
+		for (unit32 i = 0; i < 8; i++)
+			out[i] = ToShort32(_mm_srai_epi32(out[i], 3));
+		Transpose4_SSE2(out);
+		Transpose4_SSE2(out + 4);
+		for (unit32 i = 0; i < 4; i++)
+		{
+			_mm_storeu_si128((__m128i *)&dct_table[(row + i) * 8], out[i]);
+			_mm_storeu_si128((__m128i *)&dct_table[(row + i) * 8 + 4], out[i + 4]);
+		}
+	}
+}
+
+//32λĵ16λչ816λֻǰ4
+__m128i Pack16_SSE2(__m128i x)
+{
+	x = ToShort32(x);
+	return _mm_packs_epi32(x, x);
+}
+
+//ȼClampTablex<0x100Ϊ0x>=0x200Ϊ0xFFмΪx-0x100
+__m128i Clamp16_SSE2(__m128i x)
+{
+	__m128i high = _mm_set1_epi16((short)0xFF00);
+	x = _mm_subs_epu16(x, _mm_set1_epi16(0x100));
+	return _mm_subs_epu16(_mm_adds_epu16(x, high), high);
+}
+
+//һγһ8أ4ֽд0֮alphaǻ򱻶
+void Ycc2Rgb_SSE2(unit32 dc, unit32 ac, unit32 *dct_y, unit32 *dct_cb, unit32 *dct_cr, unit32 cbcr_src, unit32 stride, unit8 *data)
+{
+	__m128i bias = _mm_set1_epi16(0x180);
+	for (unit32 y = 0; y < 4; ++y)
+	{
+		__m128i cb = _mm_loadu_si128((__m128i *)&dct_cb[cbcr_src + y * 8]);
+		__m128i cr = _mm_loadu_si128((__m128i *)&dct_cr[cbcr_src + y * 8]);
+		__m128i r = _mm_srli_epi32(MulLo32(cr, _mm_set1_epi32(0x166F0)), 16);
+		__m128i g = _mm_add_epi32(_mm_srli_epi32(MulLo32(cb, _mm_set1_epi32(0x5810)), 16), _mm_srli_epi32(MulLo32(cr, _mm_set1_epi32(0xB6C0)), 16));
+		__m128i b = _mm_srli_epi32(MulLo32(cb, _mm_set1_epi32(0x1C590)), 16);
+		//ÿɫ
+		r = Pack16_SSE2(r);
+		g = Pack16_SSE2(g);
+		b = Pack16_SSE2(b);
+		r = _mm_unpacklo_epi16(r, r);
+		g = _mm_unpacklo_epi16(g, g);
+		b = _mm_unpacklo_epi16(b, b);
+		for (unit32 k = 0; k < 2; k++)
+		{
+			unit32 *src = &dct_y[y * 16 + k * 8];
+			__m128i c = _mm_add_epi16(_mm_packs_epi32(ToShort32(_mm_loadu_si128((__m128i *)src)), ToShort32(_mm_loadu_si128((__m128i *)(src + 4)))), bias);
+			__m128i bg = _mm_or_si128(Clamp16_SSE2(_mm_add_epi16(c, b)), _mm_slli_epi16(Clamp16_SSE2(_mm_sub_epi16(c, g)), 8));
+			__m128i rr = Clamp16_SSE2(_mm_add_epi16(c, r));
+			unit8 *dst = &data[(k ? ac : dc) + y * stride * 2];
+			_mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi16(bg, rr));
+			_mm_storeu_si128((__m128i *)(dst + 16), _mm_unpackhi_epi16(bg, rr));
+		}
+	}
+}
+
 unit32 ReverseByteBits(unit32 x)
 {
 	x = (x & 0xAA) >> 1 | (x & 0x55) << 1;
@@ -357,7 +564,7 @@ unit32 GetNextBit(unit8 *bits, unit32 *cached_bit, unit32 *bit, unit32 *pos, uni
 {
 	while (*cached_bit < count)
 	{
-		*bit = (*bit << 8) | ReverseByteBits(bits[(*pos)++]);
+		*bit = (*bit << 8) | ReverseTable[bits[(*pos)++]];
 		*cached_bit += 8;
 	}
 	unit32 mask = (1 << count) - 1;
@@ -365,15 +572,37 @@ unit32 GetNextBit(unit8 *bits, unit32 *cached_bit, unit32 *bit, unit32 *pos, uni
 	return (*bit >> *cached_bit) & mask;
 }
 
-unit32 NodesRead(unit32 tree_root, unit32 *Nodes, unit8 *bits, unit32 *cached_bit, unit32 *bit, unit32 *pos)
+//볤HUFF_LUT_BITSһβ꣬ĴӱµĽڵλ
+void HuffmanLut(unit32 tree_root, unit32 *Nodes, unit32 *Lut)
 {
-	unit32 v = tree_root;
+	for (unit32 code = 0; code < (1 << HUFF_LUT_BITS); code++)
+	{
+		unit32 v = tree_root, len = 0;
+		while (v >= 0x10 && len < HUFF_LUT_BITS)
+		{
+			v = Nodes[v + (((code >> (HUFF_LUT_BITS - 1 - len)) & 1) << 9)];
+			len++;
+		}
+		Lut[code] = (v << 8) | len;
+	}
+}
+
+unit32 LutRead(unit32 *Lut, unit32 *Nodes, unit8 *bits, unit32 *cached_bit, unit32 *bit, unit32 *pos)
+{
+	while (*cached_bit < HUFF_LUT_BITS)
+	{
+		*bit = (*bit << 8) | ReverseTable[bits[(*pos)++]];
+		*cached_bit += 8;
+	}
+	unit32 e = Lut[(*bit >> (*cached_bit - HUFF_LUT_BITS)) & ((1 << HUFF_LUT_BITS) - 1)];
+	*cached_bit -= e & 0xFF;
+	unit32 v = e >> 8;
 	while (v >= 0x10)
 		v = Nodes[v + (GetNextBit(bits, cached_bit, bit, pos, 1) << 9)];
 	return v;
 }
 
-void LzDecomp(unit32 bit_src, unit32 data_src, unit8* cdata, unit8 *udata, unit32 size)
+void LzDecomp(unit8 *frame, unit32 bit_src, unit32 data_src, unit8* cdata, unit8 *udata, unit32 size)
 {
 	unit32 dst = 0;
 	unit32 bit_mask = 0x80;
@@ -410,38 +639,41 @@ void LzDecomp(unit32 bit_src, unit32 data_src, unit8* cdata, unit8 *udata, unit3
 	}
 }
 
-unit8* DecodeV1(FILE *src)
+unit8* DecodeV1(PB3_Ctx *ctx, unit8 *cdata, unit32 filesize, struct pb3_header *hdr)
 {
-	unit8 *cdata = NULL, *udata = NULL, *plane = NULL;
+	unit8 *udata = NULL, *plane = NULL;
 	unit32 x_blocks = 0, y_blocks = 0, plane_size = 0, channels = 0, i = 0, stride = 0;
-	stride = PB3_Header.width * 4;
-	cdata = malloc(PB3_Header.filesize);
-	udata = malloc(stride * PB3_Header.height);
-	x_blocks = PB3_Header.width >> 4;
-	if (0 != (PB3_Header.width & 0xF))
+	if (hdr->bpp != 24 && hdr->bpp != 32)
+	{
+		wprintf(L"ֵ֧bppͣ\n");
+		return NULL;
+	}
+	stride = hdr->width * 4;
+	udata = GetBuff(ctx, BUFF_OUT, stride * hdr->height);
+	x_blocks = hdr->width >> 4;
+	if (0 != (hdr->width & 0xF))
 		++x_blocks;
-	y_blocks = PB3_Header.height >> 4;
-	if (0 != (PB3_Header.height & 0xF))
+	y_blocks = hdr->height >> 4;
+	if (0 != (hdr->height & 0xF))
 		++y_blocks;
-	plane_size = PB3_Header.width * PB3_Header.height;
-	plane = malloc(plane_size);
-	channels = PB3_Header.bpp / 8;
-	fseek(src, 0, SEEK_SET);
-	fread(cdata, PB3_Header.filesize, 1, src);
+	plane_size = hdr->width * hdr->height;
+	plane = GetBuff(ctx, BUFF_PLANE, plane_size);
+	channels = hdr->bpp / 8;
+	memset(ctx->frame, 0, 0x800);
 	for (unit32 channel = 0; channel < channels; channel++)
 	{
 		unit32 channel_offset = 4 * channels;
 		for (i = 0; i < channel; ++i)
-			channel_offset += *(unit32 *)&cdata[PB3_Header.data_off + i * 4];
-		unit32 v21 = PB3_Header.data_off + channel_offset;
+			channel_offset += *(unit32 *)&cdata[hdr->data_off + i * 4];
+		unit32 v21 = hdr->data_off + channel_offset;
 		unit32 bit_src = v21 + 12 + *(unit32 *)&cdata[v21] + *(unit32 *)&cdata[v21 + 4];
 		unit32 channel_size = *(unit32 *)&cdata[v21 + 8];
 		channel_offset = 4 * channels;
 		for (i = 0; i < channel; ++i)
-			channel_offset += *(unit32 *)&cdata[PB3_Header.alpha_size + i * 4];
-		unit32 data_src = PB3_Header.alpha_size + channel_offset;
-		memset(frame, 0, 0x7DE);
-		LzDecomp(bit_src, data_src, cdata, plane, channel_size);
+			channel_offset += *(unit32 *)&cdata[hdr->alpha_size + i * 4];
+		unit32 data_src = hdr->alpha_size + channel_offset;
+		memset(ctx->frame, 0, 0x7DE);
+		LzDecomp(ctx->frame, bit_src, data_src, cdata, plane, channel_size > plane_size ? plane_size : channel_size);
 		if (0 == y_blocks || 0 == x_blocks)
 			continue;
 		unit32 plane_src = 0;
@@ -457,8 +689,8 @@ unit8* DecodeV1(FILE *src)
 			for (unit32 x = 0; x < x_blocks; ++x)
 			{
 				unit32 dst = dst_origin;
-				unit32 block_width = v66 > PB3_Header.width ? PB3_Header.width - 16 * x : 16;
-				unit32 block_height = v68 > PB3_Header.height ? PB3_Header.height - row : 16;
+				unit32 block_width = v66 > hdr->width ? hdr->width - 16 * x : 16;
+				unit32 block_height = v68 > hdr->height ? hdr->height - row : 16;
 				if (0 == bit_mask)
 				{
 					++bit_src;
@@ -498,44 +730,27 @@ unit8* DecodeV1(FILE *src)
 			v68 += 16;
 		}
 	}
-	free(plane);
-	free(cdata);
-	if (PB3_Header.bpp == 32)
-		return udata;
-	else if (PB3_Header.bpp == 24)
-	{
-		cdata = malloc(PB3_Header.width * PB3_Header.height * 24);
-		for (i = 0; i < (unit32)PB3_Header.width * (unit32)PB3_Header.height; i++)
-		{
-			cdata[i * 3] = udata[i * 4];
-			cdata[i * 3 + 1] = udata[i * 4 + 1];
-			cdata[i * 3 + 2] = udata[i * 4 + 2];
-		}
-		free(udata);
-		return cdata;
-	}
-	else
-	{
-		wprintf(L"ֵ֧bppͣ\n");
-		system("pause");
-		free(udata);
-		return NULL;
-	}
+	ctx->Stride = stride;
+	return udata;
 }
 
-unit8* DecodeJBP(FILE *src)
+unit8* DecodeJBP(PB3_Ctx *ctx, unit8 *file, unit32 filesize, struct pb3_header *hdr)
 {
 	//JBP,žjpegص⣬ֻܴδεĳȤĿоjpeg㷨
-	//JBP͵ʱPB3_HeaderfilesizeǼȥ0x34ĳ,ԭеheadsizeλΪ0,fseek0x34
+	//JBP͵ʱPB3_HeaderfilesizeǼȥ0x34ĳ,ԭеheadsizeλΪ0,JBPͷ0x34ʼ
 	unit32 aligned_width = 0, aligned_height = 0, blocks_x = 0, blocks_y = 0, stride = 0, tree_pos = 0, i = 0, bits_offset = 0, freq[0x20];
 	unit16 quant_y[0x40], quant_c[0x40];
 	unit8 *udata = NULL, tree_data[0x10];
-	fseek(src, 0x34, SEEK_SET);
-	fread(&JBP_Header, sizeof(JBP_Header), 1, src);
+	struct jbp_header JBP_Header;
+	if (hdr->bpp != 24 && hdr->bpp != 32)
+	{
+		wprintf(L"ֵ֧bppͣ\n");
+		return NULL;
+	}
+	memcpy(&JBP_Header, file + 0x34, sizeof(JBP_Header));
 	if (strncmp(JBP_Header.sign, "JBP1", 4))
 	{
 		wprintf(L"ֵ֧type:3ļͣļͷJBP1\n");
-		system("pause");
 		return NULL;
 	}
 	switch ((JBP_Header.format >> 28) & 3)
@@ -554,45 +769,43 @@ unit8* DecodeJBP(FILE *src)
 		break;
 	default:
 		wprintf(L"δ֪format:%d", (JBP_Header.format >> 28) & 3);
-		system("pause");
+		return NULL;
+	}
+	tree_pos = 0x34 + JBP_Header.headsize + 0x80;
+	bits_offset = tree_pos + 0x10 + 0x80;
+	if ((unit64)bits_offset + JBP_Header.dc_bits + JBP_Header.ac_bits > filesize)
+	{
+		wprintf(L"JBPݳȲԣ\n");
 		return NULL;
 	}
 	blocks_x = aligned_width >> 4;
 	blocks_y = aligned_height >> 4;
 	stride = 4 * aligned_width;
-	udata = malloc(stride * aligned_height);
-	tree_pos = 0x34 + JBP_Header.headsize + 0x80;
-	fseek(src, tree_pos, SEEK_SET);
+	udata = GetBuff(ctx, BUFF_OUT, stride * aligned_height);
 	for (i = 0; i < 0x10; i++)
-	{
-		fread(&tree_data[i], 1, 1, src);
-		tree_data[i] += 1;
-	}
+		tree_data[i] = file[tree_pos + i] + 1;
 	unit32 tree_dc[0x400], tree_ac[0x400], tree_dc_root = 0, tree_ac_root = 0;
-	fseek(src, 0x34 + JBP_Header.headsize, SEEK_SET);
-	fread(freq, 0x40, 1, src);
+	memcpy(freq, file + 0x34 + JBP_Header.headsize, 0x40);
 	tree_dc_root = HuffmanTree(freq, tree_dc);
-	fread(freq, 0x40, 1, src);
+	memcpy(freq, file + 0x34 + JBP_Header.headsize + 0x40, 0x40);
 	tree_ac_root = HuffmanTree(freq, tree_ac);
+	unit32 lut_dc[1 << HUFF_LUT_BITS], lut_ac[1 << HUFF_LUT_BITS];
+	HuffmanLut(tree_dc_root, tree_dc, lut_dc);
+	HuffmanLut(tree_ac_root, tree_ac, lut_ac);
+	void (*DctFunc)(unit32 *, unit16 *) = UseSSE2 ? Dct_SSE2 : Dct;
+	void (*Ycc2RgbFunc)(unit32, unit32, unit32 *, unit32 *, unit32 *, unit32, unit32, unit8 *) = UseSSE2 ? Ycc2Rgb_SSE2 : Ycc2Rgb;
 	memset(quant_c, 0, 0x40 * 2);
 	memset(quant_y, 0, 0x40 * 2);
 	if (0 != (JBP_Header.format & 0x8000000))
 	{
 		for (i = 0; i < 0x40; ++i)
 		{
-			fseek(src, tree_pos + 0x10 + i, SEEK_SET);
-			fread(&quant_y[i], 1, 1, src);
-			fseek(src, tree_pos + 0x10 + i + 0x40, SEEK_SET);
-			fread(&quant_c[i], 1, 1, src);
+			quant_y[i] = file[tree_pos + 0x10 + i];
+			quant_c[i] = file[tree_pos + 0x10 + i + 0x40];
 		}
 	}
-	bits_offset = tree_pos + 0x10 + 0x80;
-	unit8 *bits_dc = NULL, *bits_ac = NULL;
-	bits_dc = malloc(JBP_Header.dc_bits);
-	bits_ac = malloc(JBP_Header.ac_bits);
-	fseek(src, bits_offset, SEEK_SET);
-	fread(bits_dc, JBP_Header.dc_bits, 1, src);
-	fread(bits_ac, JBP_Header.ac_bits, 1, src);
+	//ֱļļĩβв0
+	unit8 *bits_dc = file + bits_offset, *bits_ac = bits_dc + JBP_Header.dc_bits;
 	unit8 ZigzagOrder[] =
 	{
 		1,  8,  16, 9,  2,  3, 10, 17,
@@ -605,12 +818,12 @@ unit8* DecodeJBP(FILE *src)
 		60, 61, 54, 47, 55, 62, 63,  0
 	};
 	unit32 total_blocks = blocks_x * blocks_y, prev_v = 0, pos = 0, bit = 0, cached_bit = 0;
-	unit32 *blocks = malloc(total_blocks * 6 * 4);
+	unit32 *blocks = (unit32 *)GetBuff(ctx, BUFF_PLANE, total_blocks * 6 * 4);
 	for (i = 0; i < total_blocks; i++)
 	{
 		for (unit32 j = 0; j < 6; j++)
 		{
-			unit32 bit_count = NodesRead(tree_dc_root, tree_dc, bits_dc, &cached_bit, &bit, &pos);
+			unit32 bit_count = LutRead(lut_dc, tree_dc, bits_dc, &cached_bit, &bit, &pos);
 			unit32 v = (unit32)GetNextBit(bits_dc, &cached_bit, &bit, &pos, bit_count);
 			if (v < (1u << (bit_count - 1)))
 				v -= (1u << bit_count) - 1;
@@ -621,24 +834,20 @@ unit8* DecodeJBP(FILE *src)
 	cached_bit = 0;
 	bit = 0;
 	pos = 0;
-	unit32 dct_table[6];
-	for (i = 0; i < 6; i++)
-		dct_table[i] = (unit32)malloc(64 * 4);
+	unit32 (*dct_table)[64] = ctx->DctTable;
 	for (unit32 y = 0; y < blocks_y; ++y)
 	{
 		unit32 dst1 = y * stride * 16;
 		unit32 dst2 = dst1 + stride * 9;
 		for (unit32 x = 0; x < blocks_x; ++x)
 		{
-			for (unit32 j = 0; j < 6; ++j)
-				for (unit32 k = 0; k < 64; ++k)
-					((unit32 *)dct_table[j])[k] = 0;
+			memset(dct_table, 0, sizeof(ctx->DctTable));
 			for (unit32 n = 0; n < 6; ++n)
 			{
-				((unit32 *)dct_table[n])[0] = blocks[(y * blocks_x + x) * 6 + n];
+				dct_table[n][0] = blocks[(y * blocks_x + x) * 6 + n];
 				for (i = 0; i < 63;)
 				{
-					unit32 bit_count = NodesRead(tree_ac_root, tree_ac, bits_ac, &cached_bit, &bit, &pos);
+					unit32 bit_count = LutRead(lut_ac, tree_ac, bits_ac, &cached_bit, &bit, &pos);
 					if (15 == bit_count)
 						break;
 					if (0 == bit_count)
@@ -653,99 +862,69 @@ unit8* DecodeJBP(FILE *src)
 						unit32 v = (unit32)GetNextBit(bits_ac, &cached_bit, &bit, &pos, bit_count);
 						if (v < (1u << (bit_count - 1)))
 							v -= (1u << bit_count) - 1;
-						((unit32 *)dct_table[n])[ZigzagOrder[i]] = v;
+						dct_table[n][ZigzagOrder[i]] = v;
 						i++;
 					}
 				}
 			}
-			Dct((unit32 *)dct_table[0], quant_y);
-			Dct((unit32 *)dct_table[1], quant_y);
-			Dct((unit32 *)dct_table[2], quant_y);
-			Dct((unit32 *)dct_table[3], quant_y);
-			Dct((unit32 *)dct_table[4], quant_c);
-			Dct((unit32 *)dct_table[5], quant_c);
-			Ycc2Rgb(dst1, dst1 + stride, (unit32 *)dct_table[0], (unit32 *)dct_table[4], (unit32 *)dct_table[5], 0, stride, udata);
-			Ycc2Rgb(dst1 + 32, dst1 + stride + 32, (unit32 *)dct_table[1], (unit32 *)dct_table[4], (unit32 *)dct_table[5], 4, stride, udata);
-			Ycc2Rgb(dst2 - stride, dst2, (unit32 *)dct_table[2], (unit32 *)dct_table[4], (unit32 *)dct_table[5], 32, stride, udata);
-			Ycc2Rgb(dst2 - stride + 32, dst2 + 32, (unit32 *)dct_table[3], (unit32 *)dct_table[4], (unit32 *)dct_table[5], 36, stride, udata);
+			DctFunc(dct_table[0], quant_y);
+			DctFunc(dct_table[1], quant_y);
+			DctFunc(dct_table[2], quant_y);
+			DctFunc(dct_table[3], quant_y);
+			DctFunc(dct_table[4], quant_c);
+			DctFunc(dct_table[5], quant_c);
+			Ycc2RgbFunc(dst1, dst1 + stride, dct_table[0], dct_table[4], dct_table[5], 0, stride, udata);
+			Ycc2RgbFunc(dst1 + 32, dst1 + stride + 32, dct_table[1], dct_table[4], dct_table[5], 4, stride, udata);
+			Ycc2RgbFunc(dst2 - stride, dst2, dct_table[2], dct_table[4], dct_table[5], 32, stride, udata);
+			Ycc2RgbFunc(dst2 - stride + 32, dst2 + 32, dct_table[3], dct_table[4], dct_table[5], 36, stride, udata);
 			dst1 += 64;
 			dst2 += 64;
 		}
 	}
-	free(bits_ac);
-	free(bits_dc);
-	free(blocks);
-	for (i = 0; i < 6; i++)
-		free((unit32 *)dct_table[i]);
-	if (PB3_Header.bpp == 24)
+	ctx->Stride = stride;
+	if (hdr->bpp == 32)
 	{
-		unit8 *data = malloc(PB3_Header.width * PB3_Header.height * 3);
-		for (i = 0; i < (unit32)PB3_Header.width * (unit32)PB3_Header.height; i++)
+		if (hdr->data_off == 0 || hdr->alpha_size == 0 || (unit64)hdr->data_off + hdr->alpha_size > filesize)
 		{
-			data[i * 3] = udata[i * 4];
-			data[i * 3 + 1] = udata[i * 4 + 1];
-			data[i * 3 + 2] = udata[i * 4 + 2];
-		}
-		free(udata);
-		return data;
-	}
-	else if (PB3_Header.bpp == 32)
-	{
-		if (PB3_Header.data_off == 0 || PB3_Header.alpha_size == 0)
-		{
-			wprintf(L"alpha_offalpha_sizeΪ0alpha_off:0x%X alpha_size:0x%X\n", PB3_Header.data_off, PB3_Header.alpha_size);
-			system("pause");
-			free(udata);
+			wprintf(L"alpha_offalpha_sizeԣalpha_off:0x%X alpha_size:0x%X\n", hdr->data_off, hdr->alpha_size);
 			return NULL;
 		}
-		fseek(src, PB3_Header.data_off, SEEK_SET);
-		unit8 *data = malloc(PB3_Header.alpha_size);
-		fread(data, PB3_Header.alpha_size, 1, src);
-		unit32 out = 3;
-		for (i = 0; i < PB3_Header.alpha_size; i++)
+		//alphaǰԭʼŵģл㵽stride
+		unit8 *data = file + hdr->data_off;
+		unit32 out = 3, x = 0, y = 0;
+		for (i = 0; i < hdr->alpha_size && y < JBP_Header.height; i++)
 		{
-			if (0 != data[i] && 0xFF != data[i])
+			unit8 alpha = data[i];
+			unit32 count = 1;
+			if (0 == alpha || 0xFF == alpha)
+				count = data[++i];
+			while (count--> 0 && y < JBP_Header.height)
 			{
-				udata[out] = data[i];
+				udata[out] = alpha;
 				out += 4;
-			}
-			else
-			{
-				unit8 alpha = data[i++];
-				unit32 count = data[i];
-				while (count--> 0)
+				if (++x == JBP_Header.width)
 				{
-					udata[out] = alpha;
-					out += 4;
+					x = 0;
+					y++;
+					out = y * stride + 3;
 				}
 			}
 		}
-		free(data);
-		return udata;
-	}
-	else
-	{
-		wprintf(L"ֵ֧bppͣ\n");
-		system("pause");
-		free(udata);
-		return NULL;
 	}
+	return udata;
 }
 
-unit8* DecodeV5(FILE *src, unit32 width, unit32 height, unit32 bpp, unit32 headsize, unit32 filesize)
+unit8* DecodeV5(PB3_Ctx *ctx, unit8 *file, unit32 filesize, struct pb3_header *hdr)
 {
-	unit8 *cdata = NULL, *udata = NULL;
-	unit32 bit_src = 0, data_src = 0, i = 0, length = width * height * bpp / 8;
-	udata = malloc(length);
+	unit8 *cdata = NULL, *udata = NULL, *frame = ctx->frame;
+	unit32 bit_src = 0, data_src = 0, i = 0, length = hdr->width * hdr->height * 4;
+	udata = GetBuff(ctx, BUFF_OUT, length);
 	memset(frame, 0, 0x800);
-	fseek(src, headsize + 0x20, SEEK_SET);
-	cdata = malloc(filesize - headsize - 0x20);
-	fread(cdata, filesize - headsize - 0x20, 1, src);
+	cdata = file + hdr->headsize + 0x20;
 	for (i = 0; i < 4; i++)
 	{
-		fseek(src, headsize + i * 8, SEEK_SET);
-		fread(&bit_src, 4, 1, src);
-		fread(&data_src, 4, 1, src);
+		bit_src = *(unit32 *)&file[hdr->headsize + i * 8];
+		data_src = *(unit32 *)&file[hdr->headsize + i * 8 + 4];
 		memset(frame, 0, 0x7DE);
 		unit32 frame_offset = 0x7DE;
 		unit8 accum = 0;
@@ -764,7 +943,7 @@ unit8* DecodeV5(FILE *src, unit32 width, unit32 height, unit32 bpp, unit32 heads
 				data_src += 2;
 				unit32 count = (v & 0x1F) + 3;
 				unit32 offset = v >> 5;
-				for (unit32 k = 0; k < count; ++k)
+				for (unit32 k = 0; k < count && dst < length; ++k)
 				{
 					unit8 b = frame[(k + offset) & 0x7FF];
 					frame[frame_offset++] = b;
@@ -786,171 +965,211 @@ unit8* DecodeV5(FILE *src, unit32 width, unit32 height, unit32 bpp, unit32 heads
 			bit_mask >>= 1;
 		}
 	}
-	free(cdata);
+	ctx->Stride = hdr->width * 4;
 	return udata;
 }
 
-unit8* DecodeV6(FILE *src)
+unit8* DecodeV6(PB3_Ctx *ctx, unit8 *file, unit32 filesize, struct pb3_header *hdr)
 {
 	unit8 name[0x20], key[] = { 0xA6, 0x75, 0xF3, 0x9C, 0xC5, 0x69, 0x78, 0xA3, 0x3E, 0xA5, 0x4F, 0x79, 0x59, 0xFE, 0x3A, 0xC7 };
 	WCHAR wname[0x30];
-	unit8 *base_data = NULL, *cdata = NULL, *udata = NULL;
-	unit32 bit_src = 0, data_src = 0, bit_mask = 0, x_blocks = 0, y_blocks = 0, h = 0, dst_origin = 0, stride = PB3_Header.width * PB3_Header.bpp / 8;
-	fread(name, 0x20, 1, src);
+	unit8 *base_file = NULL, *base_data = NULL, *cdata = NULL, *udata = NULL;
+	unit32 base_size = 0, bit_src = 0, data_src = 0, bit_mask = 0, x_blocks = 0, y_blocks = 0, h = 0, dst_origin = 0, stride = 0;
+	memcpy(name, file + hdr->headsize, 0x20);
 	for (unit32 i = 0; i < 0x20; i++)
 		name[i] ^= key[i & 0x0F];
+	memset(wname, 0, sizeof(wname));
 	MultiByteToWideChar(932, 0, name, 0x20, wname, 0x20);
 	wcscat(wname, L".pb3");
-	wprintf(L"basepic:%ls ", wname);
-	if (_waccess(wname, 0) == -1)
+	if ((base_file = LoadFile(ctx, BUFF_BASE_FILE, wname, &base_size)) == NULL)
 	{
-		wprintf(L"basepicڣ뽫ļͬһĿ¼£\n");
-		system("pause");
+		wprintf(L"basepic:%lsڣ뽫ļͬһĿ¼£\n", wname);
+		return NULL;
 	}
-	else
+	struct pb3_header base_header;
+	if (!ReadIndex(base_file, base_size, &base_header))
+		return NULL;
+	//basepicֱӽ⵽BUFF_OUTٰѲֿ鸲ȥ
+	switch (base_header.type)
 	{
-		FILE *base = _wfopen(wname, L"rb");
-		struct pb3_header base_header;
-		ReadIndex(base, &base_header);
-		switch (base_header.type)
-		{
-		case 1:
-			//DecodeV1(pbtSrc, dwSrcSize, lWidth, lHeight, wBpp);
-			break;
-		case 2:
-		case 3:
-			base_data = DecodeJBP(src);
-			break;
-		case 4:
-			//DecodeV4(pbtSrc, dwSrcSize, lWidth, lHeight, wBpp);
-			break;
-		case 5:
-			base_data = DecodeV5(base, base_header.width, base_header.height, base_header.bpp, base_header.headsize, base_header.filesize);
-			break;
-		case 6:
-			wprintf(L"basepicͼƬô6ش\n");
-			base_data = NULL;
-			system("pause");
-			break;
-		default:
-			wprintf(L"basepicΪֵ֧ͼƬ:%d\n", base_header.type);
-			base_data = NULL;
-			system("pause");
-			break;
-		}
-		fclose(base);
-		if (base_data)
+	case 1:
+		base_data = DecodeV1(ctx, base_file, base_size, &base_header);
+		break;
+	case 2:
+	case 3:
+		base_data = DecodeJBP(ctx, base_file, base_size, &base_header);
+		break;
+	case 4:
+		//DecodeV4(pbtSrc, dwSrcSize, lWidth, lHeight, wBpp);
+		break;
+	case 5:
+		base_data = DecodeV5(ctx, base_file, base_size, &base_header);
+		break;
+	case 6:
+		wprintf(L"basepicͼƬô6ش\n");
+		base_data = NULL;
+		break;
+	default:
+		wprintf(L"basepicΪֵ֧ͼƬ:%d\n", base_header.type);
+		base_data = NULL;
+		break;
+	}
+	if (base_data)
+	{
+		stride = ctx->Stride;
+		cdata = file + hdr->headsize + 0x20;
+		udata = GetBuff(ctx, BUFF_PLANE, hdr->data_size);
+		memset(ctx->frame, 0, 0x800);
+		LzDecomp(ctx->frame, 0, hdr->data_off, cdata, udata, hdr->data_size);
+		bit_src = 8;
+		data_src = bit_src + *(unit32 *)udata;
+		bit_mask = 0x80;
+		x_blocks = hdr->width >> 3;
+		if (0 != (hdr->width & 7))
+			++x_blocks;
+		y_blocks = hdr->height >> 3;
+		if (0 != (hdr->height & 7))
+			++y_blocks;
+		while (y_blocks > 0)
 		{
-			fseek(src, PB3_Header.headsize + 0x20, SEEK_SET);
-			cdata = malloc(PB3_Header.filesize - PB3_Header.headsize - 0x20);
-			fread(cdata, PB3_Header.filesize - PB3_Header.headsize - 0x20, 1, src);
-			udata = malloc(PB3_Header.data_size);
-			LzDecomp(0, PB3_Header.data_off, cdata, udata, PB3_Header.data_size);
-			free(cdata);
-			bit_src = 8;
-			data_src = bit_src + *(unit32 *)udata;
-			bit_mask = 0x80;
-			x_blocks = PB3_Header.width >> 3;
-			if (0 != (PB3_Header.width & 7))
-				++x_blocks;
-			y_blocks = PB3_Header.height >> 3;
-			if (0 != (PB3_Header.height & 7))
-				++y_blocks;
-			while (y_blocks > 0)
+			unit32 w = 0;
+			for (unit32 x = 0; x < x_blocks; ++x)
 			{
-				unit32 w = 0;
-				for (unit32 x = 0; x < x_blocks; ++x)
+				if (0 == bit_mask)
 				{
-					if (0 == bit_mask)
-					{
-						++bit_src;
-						bit_mask = 0x80;
-					}
-					if (0 == (bit_mask & udata[bit_src]))
+					++bit_src;
+					bit_mask = 0x80;
+				}
+				if (0 == (bit_mask & udata[bit_src]))
+				{
+					unit32 dst = 8 * (dst_origin + 4 * x);
+					unit32 x_count = 8 < hdr->width - w ? 8 : hdr->width - w;
+					unit32 y_count = 8 < hdr->height - h ? 8 : hdr->height - h;
+					for (unit32 v30 = y_count; v30 > 0; --v30)
 					{
-						unit32 dst = 8 * (dst_origin + 4 * x);
-						unit32 x_count = 8 < PB3_Header.width - w ? 8 : PB3_Header.width - w;
-						unit32 y_count = 8 < PB3_Header.height - h ? 8 : PB3_Header.height - h;
-						for (unit32 v30 = y_count; v30 > 0; --v30)
-						{
-							unit32 count = 4 * x_count;
-							memcpy(&base_data[dst], &udata[data_src], count);
-							data_src += count;
-							dst += stride;
-						}
+						unit32 count = 4 * x_count;
+						memcpy(&base_data[dst], &udata[data_src], count);
+						data_src += count;
+						dst += stride;
 					}
-					bit_mask >>= 1;
-					w += 8;
 				}
-				dst_origin += stride;
-				h += 8;
-				--y_blocks;
+				bit_mask >>= 1;
+				w += 8;
 			}
-			free(udata);
+			dst_origin += stride;
+			h += 8;
+			--y_blocks;
 		}
 	}
 	return base_data;
 }
 
-void WritePngFile()
+//ʱֻӡϢFALSEɵ߼ڹ߳ͣ
+BOOL DecodePB3File(PB3_Ctx *ctx, WCHAR *fname)
 {
-	FILE *src = NULL, *dst = NULL;
-	unit32 i = 0;
-	unit8 *data = NULL;
+	FILE *dst = NULL;
+	unit32 filesize = 0;
+	unit8 *file = NULL, *data = NULL;
+	struct pb3_header PB3_Header;
 	WCHAR dstname[MAX_PATH];
-	for (i = 0; i < FileNum; i++)
+	if ((file = LoadFile(ctx, BUFF_FILE, fname, &filesize)) == NULL)
+	{
+		wprintf(L"name:%ls ޷ļ\n", fname);
+		return FALSE;
+	}
+	if (!ReadIndex(file, filesize, &PB3_Header))
+		return FALSE;
+	wsprintfW(dstname, L"%ls.png", fname);
+	switch (PB3_Header.type)
 	{
-		src = _wfopen(Index[i].FileName, L"rb");
-		wprintf(L"name:%ls ", Index[i].FileName);
-		ReadIndex(src, &PB3_Header);
-		wprintf(L"width:%d height:%d bpp:%d type:%d ", PB3_Header.width, PB3_Header.height, PB3_Header.bpp, PB3_Header.type);
-		wsprintfW(dstname, L"%ls.png", Index[i].FileName);
+	case 1://Ҫ
+		data = DecodeV1(ctx, file, filesize, &PB3_Header);
+		break;
+	case 2://2ľ32λJBP
+	case 3://JBPƺCGBG
+		data = DecodeJBP(ctx, file, filesize, &PB3_Header);
+		break;
+	case 4://û
+		wprintf(L"֧v4͵ͼƬ\n");
+		break;
+	case 5://Ҫ
+		data = DecodeV5(ctx, file, filesize, &PB3_Header);
+		break;
+	case 6://ͼ
+		data = DecodeV6(ctx, file, filesize, &PB3_Header);
+		break;
+	default:
+		wprintf(L"ֵ֧ͼƬ͡\n");
 		data = NULL;
-		switch (PB3_Header.type)
-		{
-		case 1://Ҫ
-			data = DecodeV1(src);
-			break;
-		case 2://2ľ32λJBP
-		case 3://JBPƺCGBG
-			data = DecodeJBP(src);
-			break;
-		case 4://û
-			wprintf(L"֧v4͵ͼƬ");
-			system("pause");
-			break;
-		case 5://Ҫ
-			data = DecodeV5(src, PB3_Header.width, PB3_Header.height, PB3_Header.bpp, PB3_Header.headsize, PB3_Header.filesize);
-			break;
-		case 6://ͼ
-			data = DecodeV6(src);
-			break;
-		default:
-			wprintf(L"ֵ֧ͼƬ͡");
-			data = NULL;
-			system("pause");
+		break;
+	}
+	//߳ʱһһ⻥ഩ
+	wprintf(L"name:%ls width:%d height:%d bpp:%d type:%d%ls\n", fname, PB3_Header.width, PB3_Header.height, PB3_Header.bpp, PB3_Header.type, data ? L"" : L" ʧ");
+	if (!data)
+		return FALSE;
+	dst = _wfopen(dstname, L"wb");
+	if (!WritePng(dst, PB3_Header.width, PB3_Header.height, PB3_Header.bpp, ctx->Stride, data))
+	{
+		fclose(dst);
+		_wremove(dstname);
+		return FALSE;
+	}
+	fclose(dst);
+	return TRUE;
+}
+
+DWORD WINAPI DecodeThread(LPVOID param)
+{
+	PB3_Ctx *ctx = calloc(1, sizeof(PB3_Ctx));
+	for (;;)
+	{
+		LONG n = InterlockedIncrement(&TaskCursor) - 1;
+		if ((unit32)n >= FileNum)
 			break;
-		}
-		wprintf(L"\n");
-		if (data)
-		{
-			dst = _wfopen(dstname, L"wb");
-			//fwrite(data, _msize(data), 1, dst);
-			WritePng(dst, PB3_Header.width, PB3_Header.height, PB3_Header.bpp, data);
-			free(data);
-			fclose(dst);
-		}
-		fclose(src);
+		if (!DecodePB3File(ctx, Index[n].FileName))
+			InterlockedIncrement(&FailNum);
+	}
+	FreePB3Ctx(ctx);
+	return 0;
+}
+
+void WritePngFile(unit32 ThreadNum)
+{
+	if (ThreadNum == 0)
+	{
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		ThreadNum = info.dwNumberOfProcessors;
 	}
+	if (ThreadNum > MAXIMUM_WAIT_OBJECTS)
+		ThreadNum = MAXIMUM_WAIT_OBJECTS;
+	if (ThreadNum > FileNum)
+		ThreadNum = FileNum ? FileNum : 1;
+	printf("thread_num:%d\n\n", ThreadNum);
+	HANDLE *Threads = malloc(sizeof(HANDLE) * ThreadNum);
+	for (unit32 i = 0; i < ThreadNum; i++)
+		Threads[i] = CreateThread(NULL, 0, DecodeThread, NULL, 0, NULL);
+	WaitForMultipleObjects(ThreadNum, Threads, TRUE, INFINITE);
+	for (unit32 i = 0; i < ThreadNum; i++)
+		CloseHandle(Threads[i]);
+	free(Threads);
+	for (unit32 i = 0; i < FileNum; i++)
+		free(Index[i].FileName);
+	free(Index);
 }
 
 int main(int argc, char *argv[])
 {
 	setlocale(LC_ALL, "chs");
-	printf("projectNiflheim-cmvs\nڵpb3ͼƬ\nļϵϡ\nby Darkness-TX 2018.08.16\n\n");
+	UseSSE2 = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+	for (unit32 i = 0; i < 0x10000; i++)
+		ClampTable[i] = i < 0x100 ? 0 : i < 0x200 ? i - 0x100 : 0xFF;
+	for (unit32 i = 0; i < 0x100; i++)
+		ReverseTable[i] = ReverseByteBits(i);
+	printf("projectNiflheim-cmvs\nڵpb3ͼƬ\nļϵϡ\nѡڶָת߳ĬΪCPU\nby Darkness-TX 2018.08.16\n\n");
 	process_dir(argv[1]);
-	WritePngFile();
-	printf("ɣļ%d\n", FileNum);
+	WritePngFile(argc > 2 ? atoi(argv[2]) : 0);
+	printf("ɣļ%dʧ%d\n", FileNum, FailNum);
 	system("pause");
 	return 0;
-}
\ No newline at end of file
+}
@@ -1,6 +1,6 @@
 /*
-ڽpngͼƬתɼ򵥵pb3
-Longinus 1.4.1.0
+ڽpngͼƬתpb3
+Ĭv5ͨ+LZѹָbasepicʱͬߴͼΪv6ͼ
 made by Darkness-TX
 2018.11.09
 */
@@ -20,6 +20,7 @@ typedef unsigned int   unit32;
 typedef unsigned __int64 unit64;
 
 unit32 FileNum = 0;//ļʼΪ0
+unit8 v6_key[] = { 0xA6, 0x75, 0xF3, 0x9C, 0xC5, 0x69, 0x78, 0xA3, 0x3E, 0xA5, 0x4F, 0x79, 0x59, 0xFE, 0x3A, 0xC7 };
 
 struct index
 {
@@ -27,6 +28,42 @@ struct index
 	unit32 FileSize;//ļС
 }Index[50000];
 
+struct pb3_header
+{
+	unit8 sign[4];//PB3B
+	unit32 filesize;
+	unit32 unk0;
+	unit32 headsize;//0x34
+	unit32 unk1;
+	unit32 unk2;
+	unit32 data_size;//v6ãݽѹĳ
+	unit16 type;
+	unit16 width;
+	unit16 height;
+	unit16 bpp;
+	unit32 unk4;
+	unit32 unk5;
+	unit32 data_off;//v6ãѹ־λ֮ƫ
+	unit32 alpha_size;
+};
+
+//һͨLZѹ־λݷֿţӦpb32pngLzDecompbit_srcdata_src
+typedef struct lz_stream
+{
+	unit8 *src;
+	unit32 size;
+	unit8 *Flag;
+	unit32 FlagLen;
+	unit8 *Data;
+	unit32 DataLen;
+}LZ_Stream;
+
+#define LZ_WINDOW 0x7FF
+#define LZ_MIN_MATCH 3
+#define LZ_MAX_MATCH 34
+#define LZ_HASH_BITS 12
+#define LZ_MAX_CHAIN 64
+
 unit32 process_dir(char *dname)
 {
 	long Handle;
@@ -49,7 +86,7 @@ unit32 process_dir(char *dname)
 	return FileNum;
 }
 
-unit8* ReadPng(FILE *pngfile, unit32 *picsize)
+unit8* ReadPng(FILE *pngfile, unit32 *picwidth, unit32 *picheight)
 {
 	png_structp png_ptr;
 	png_infop info_ptr, end_ptr;
@@ -82,9 +119,10 @@ unit8* ReadPng(FILE *pngfile, unit32 *picsize)
 	png_get_IHDR(png_ptr, info_ptr, (png_uint_32*)&width, (png_uint_32*)&height, &bpp, &format, NULL, NULL, NULL);
 	if (format == PNG_COLOR_TYPE_RGB)
 	{
-		wprintf(L"width:%d height:%d bpp:24\n", width, height);
+		wprintf(L"width:%d height:%d bpp:24 ", width, height);
 		unit8 *odata = malloc(width * height * 3);
-		*picsize = width * height * 4;
+		*picwidth = width;
+		*picheight = height;
 		rows = (png_bytep*)malloc(height * sizeof(char*));
 		for (i = 0; i < height; i++)
 			rows[i] = (png_bytep)(odata + width*i * 3);
@@ -109,9 +147,10 @@ unit8* ReadPng(FILE *pngfile, unit32 *picsize)
 	}
 	else if (format == PNG_COLOR_TYPE_RGB_ALPHA)
 	{
-		wprintf(L"width:%d height:%d bpp:32\n", width, height);
+		wprintf(L"width:%d height:%d bpp:32 ", width, height);
 		unit8 *data = malloc(width * height * 4);
-		*picsize = width * height * 4;
+		*picwidth = width;
+		*picheight = height;
 		rows = (png_bytep*)malloc(height * sizeof(char*));
 		for (i = 0; i < height; i++)
 			rows[i] = (png_bytep)(data + width*i * 4);
@@ -130,39 +169,315 @@ unit8* ReadPng(FILE *pngfile, unit32 *picsize)
 	else
 	{
 		wprintf(L"ֵ֧ͼƬͣ\n");
+		png_destroy_read_struct(&png_ptr, &info_ptr, &end_ptr);
 		system("pause");
 	}
 	return NULL;
 }
 
-void WritePngFile()
+unit32 LzHash(unit8 *p)
+{
+	return ((p[0] << 8) ^ (p[1] << 4) ^ p[2]) & ((1 << LZ_HASH_BITS) - 1);
+}
+
+void LzInsert(unit8 *src, unit32 size, unit32 pos, int *head, int *prev)
+{
+	if (pos + LZ_MIN_MATCH > size)
+		return;
+	unit32 h = LzHash(&src[pos]);
+	prev[pos] = head[h];
+	head[h] = pos;
+}
+
+unit32 LzFindMatch(unit8 *src, unit32 size, unit32 pos, int *head, int *prev, unit32 *match)
+{
+	unit32 best = 0, chain = LZ_MAX_CHAIN, max = size - pos < LZ_MAX_MATCH ? size - pos : LZ_MAX_MATCH;
+	if (max < LZ_MIN_MATCH)
+		return 0;
+	int cur = head[LzHash(&src[pos])];
+	while (cur >= 0 && pos - cur <= LZ_WINDOW && chain-- > 0)
+	{
+		unit32 len = 0;
+		while (len < max && src[cur + len] == src[pos + len])
+			len++;
+		if (len > best)
+		{
+			best = len;
+			*match = cur;
+			if (len == max)
+				break;
+		}
+		cur = prev[cur];
+	}
+	return best;
+}
+
+/*
+0x800ƥ3~34ֽڣƫǽѹframeľλãnֽ(0x7DE + n) & 0x7FF
+ֻñѾݣframeĳʼݡ
+ϣƥ䣬һλƥøʱһ
+*/
+void LzCompress(LZ_Stream *lz)
+{
+	unit8 *src = lz->src;
+	unit32 size = lz->size, pos = 0, flag_pos = 0, bit_mask = 0;
+	int *head = malloc(sizeof(int) * (1 << LZ_HASH_BITS));
+	int *prev = malloc(sizeof(int) * (size ? size : 1));
+	lz->Flag = malloc(size / 8 + 2);
+	lz->Data = malloc(size + 2);
+	lz->FlagLen = 0;
+	lz->DataLen = 0;
+	memset(head, 0xFF, sizeof(int) * (1 << LZ_HASH_BITS));
+	while (pos < size)
+	{
+		unit32 match = 0, next = 0, len = LzFindMatch(src, size, pos, head, prev, &match);
+		BOOL inserted = FALSE;
+		if (len >= LZ_MIN_MATCH && len < LZ_MAX_MATCH && pos + 1 < size)
+		{
+			LzInsert(src, size, pos, head, prev);
+			inserted = TRUE;
+			if (LzFindMatch(src, size, pos + 1, head, prev, &next) > len)
+				len = 0;
+		}
+		if (bit_mask == 0)
+		{
+			flag_pos = lz->FlagLen++;
+			lz->Flag[flag_pos] = 0;
+			bit_mask = 0x80;
+		}
+		if (len >= LZ_MIN_MATCH)
+		{
+			lz->Flag[flag_pos] |= bit_mask;
+			*(unit16 *)&lz->Data[lz->DataLen] = (unit16)((((0x7DE + match) & 0x7FF) << 5) | (len - LZ_MIN_MATCH));
+			lz->DataLen += 2;
+			for (unit32 i = inserted ? 1 : 0; i < len; i++)
+				LzInsert(src, size, pos + i, head, prev);
+			pos += len;
+		}
+		else
+		{
+			lz->Data[lz->DataLen++] = src[pos];
+			if (!inserted)
+				LzInsert(src, size, pos, head, prev);
+			pos++;
+		}
+		bit_mask >>= 1;
+	}
+	free(prev);
+	free(head);
+}
+
+DWORD WINAPI LzThread(LPVOID param)
+{
+	LzCompress((LZ_Stream *)param);
+	return 0;
+}
+
+//ͨأһͨһ߳
+void LzCompressAll(LZ_Stream *lz, unit32 count)
+{
+	HANDLE Threads[4];
+	for (unit32 i = 0; i < count; i++)
+		Threads[i] = CreateThread(NULL, 0, LzThread, &lz[i], 0, NULL);
+	WaitForMultipleObjects(count, Threads, TRUE, INFINITE);
+	for (unit32 i = 0; i < count; i++)
+		CloseHandle(Threads[i]);
+}
+
+//ͷ0x8~0x34ȼļĩβ0x2Fʼֽڣٰ16λĩβ-3keypb32pngdecrypt_header
+void EncryptHeader(unit8 *file, unit32 filesize)
+{
+	unit8 *p = file, *key_data = file + filesize - 0x2F;
+	unit16 key = *(unit16 *)&file[filesize - 3];
+	unit32 i = 0;
+	for (i = 8; i < 0x34; i++)
+		p[i] += key_data[i - 8];
+	for (i = 8; i < 0x34; i += 2)
+		*(unit16 *)&p[i] ^= key;
+}
+
+//ĩβҪͷԿã0x34+0x2Fֽڣʱ0
+unit8* NewPB3File(unit32 bodysize, unit32 *filesize)
+{
+	*filesize = bodysize < 0x34 + 0x2F ? 0x34 + 0x2F : bodysize;
+	unit8 *file = malloc(*filesize);
+	memset(file, 0, *filesize);
+	return file;
+}
+
+void FillHeader(unit8 *file, unit32 filesize, unit16 type, unit32 width, unit32 height)
+{
+	struct pb3_header *PB3 = (struct pb3_header *)file;
+	memcpy(PB3->sign, "PB3B", 4);
+	PB3->filesize = filesize;
+	PB3->headsize = 0x34;
+	PB3->type = type;
+	PB3->width = width;
+	PB3->height = height;
+	PB3->bpp = 32;
+}
+
+/*
+v50x34ͷ4ͨһ(bit_src, data_src)ƫƴ0x54
+ÿֽͨڲֺ󵥶ѹѹۼӻԭ
+*/
+unit8* EncodeV5(unit8 *data, unit32 width, unit32 height, unit32 *filesize)
+{
+	LZ_Stream lz[4];
+	unit32 pixels = width * height, offset = 0;
+	for (unit32 ch = 0; ch < 4; ch++)
+	{
+		unit8 prev = 0;
+		lz[ch].src = malloc(pixels ? pixels : 1);
+		lz[ch].size = pixels;
+		for (unit32 i = 0; i < pixels; i++)
+		{
+			lz[ch].src[i] = data[i * 4 + ch] - prev;
+			prev = data[i * 4 + ch];
+		}
+	}
+	LzCompressAll(lz, 4);
+	unit32 bodysize = 0x34 + 0x20;
+	for (unit32 ch = 0; ch < 4; ch++)
+		bodysize += lz[ch].FlagLen + lz[ch].DataLen;
+	unit8 *file = NewPB3File(bodysize, filesize);
+	FillHeader(file, *filesize, 5, width, height);
+	unit8 *cdata = file + 0x34 + 0x20;
+	for (unit32 ch = 0; ch < 4; ch++)
+	{
+		*(unit32 *)&file[0x34 + ch * 8] = offset;
+		memcpy(cdata + offset, lz[ch].Flag, lz[ch].FlagLen);
+		offset += lz[ch].FlagLen;
+		*(unit32 *)&file[0x34 + ch * 8 + 4] = offset;
+		memcpy(cdata + offset, lz[ch].Data, lz[ch].DataLen);
+		offset += lz[ch].DataLen;
+		free(lz[ch].src);
+		free(lz[ch].Flag);
+		free(lz[ch].Data);
+	}
+	EncryptHeader(file, *filesize);
+	return file;
+}
+
+/*
+v60x34ͷ0x20ֽbasepicѹĲݡ
+ݽѹΪ[־λ][ݳ][־λ][]8x8Ϊһ飬basepicͬĿλΪ0ء
+*/
+unit8* EncodeV6(unit8 *data, unit8 *base, unit32 width, unit32 height, WCHAR *basename, unit32 *filesize)
+{
+	unit32 x_blocks = (width + 7) >> 3, y_blocks = (height + 7) >> 3;
+	unit32 flag_len = (x_blocks * y_blocks + 7) >> 3, stride = width * 4;
+	unit8 *diff = malloc(8 + flag_len + width * height * 4);
+	unit8 *flag = diff + 8, *block = diff + 8 + flag_len;
+	unit32 block_len = 0, n = 0;
+	memset(flag, 0, flag_len);
+	for (unit32 y = 0; y < height; y += 8)
+	{
+		unit32 y_count = height - y < 8 ? height - y : 8;
+		for (unit32 x = 0; x < width; x += 8, n++)
+		{
+			unit32 x_count = width - x < 8 ? width - x : 8;
+			BOOL same = TRUE;
+			for (unit32 j = 0; j < y_count && same; j++)
+				same = !memcmp(&data[(y + j) * stride + x * 4], &base[(y + j) * stride + x * 4], x_count * 4);
+			if (same)
+				flag[n >> 3] |= 0x80 >> (n & 7);
+			else
+			{
+				for (unit32 j = 0; j < y_count; j++)
+				{
+					memcpy(&block[block_len], &data[(y + j) * stride + x * 4], x_count * 4);
+					block_len += x_count * 4;
+				}
+			}
+		}
+	}
+	*(unit32 *)&diff[0] = flag_len;
+	*(unit32 *)&diff[4] = block_len;
+	LZ_Stream lz;
+	lz.src = diff;
+	lz.size = 8 + flag_len + block_len;
+	LzCompress(&lz);
+	unit8 *file = NewPB3File(0x34 + 0x20 + lz.FlagLen + lz.DataLen, filesize);
+	FillHeader(file, *filesize, 6, width, height);
+	struct pb3_header *PB3 = (struct pb3_header *)file;
+	PB3->data_size = lz.size;
+	PB3->data_off = lz.FlagLen;
+	unit8 *name = file + 0x34;
+	WideCharToMultiByte(932, 0, basename, -1, name, 0x20, NULL, FALSE);
+	for (unit32 i = 0; i < 0x20; i++)
+		name[i] ^= v6_key[i & 0x0F];
+	memcpy(file + 0x34 + 0x20, lz.Flag, lz.FlagLen);
+	memcpy(file + 0x34 + 0x20 + lz.FlagLen, lz.Data, lz.DataLen);
+	free(lz.Flag);
+	free(lz.Data);
+	free(diff);
+	EncryptHeader(file, *filesize);
+	return file;
+}
+
+void WritePngFile(WCHAR *basepic)
 {
 	FILE *src = NULL, *dst = NULL;
-	unit32 i = 0, picsize = 0;
-	unit8 *data = NULL;
-	WCHAR dstname[MAX_PATH], *buff;
+	unit32 i = 0, width = 0, height = 0, base_width = 0, base_height = 0, filesize = 0;
+	unit8 *data = NULL, *base = NULL, *file = NULL;
+	WCHAR dstname[MAX_PATH], basename[MAX_PATH], *buff;
+	if (basepic)
+	{
+		src = _wfopen(basepic, L"rb");
+		if (src == NULL)
+		{
+			wprintf(L"basepic:%lsڣ\n", basepic);
+			system("pause");
+			exit(0);
+		}
+		wprintf(L"basepic:%ls ", basepic);
+		base = ReadPng(src, &base_width, &base_height);
+		wprintf(L"\n");
+		fclose(src);
+		wcscpy(basename, basepic);
+		if ((buff = wcsrchr(basename, L'.')) != NULL)
+			*buff = L'\0';
+	}
 	for (i = 0; i < FileNum; i++)
 	{
 		src = _wfopen(Index[i].FileName, L"rb");
 		wprintf(L"name:%ls ", Index[i].FileName);
-		data = ReadPng(src, &picsize);
+		data = ReadPng(src, &width, &height);
+		fclose(src);
+		if (data == NULL)
+			continue;
+		if (base && _wcsicmp(Index[i].FileName, basepic) && width == base_width && height == base_height)
+		{
+			file = EncodeV6(data, base, width, height, basename, &filesize);
+			wprintf(L"type:6 size:0x%X\n", filesize);
+		}
+		else
+		{
+			file = EncodeV5(data, width, height, &filesize);
+			wprintf(L"type:5 size:0x%X\n", filesize);
+		}
 		buff = wcsrchr(Index[i].FileName, L'.');
 		*buff = L'\0';
 		wsprintfW(dstname, L"%s.pb3", Index[i].FileName);
 		dst = _wfopen(dstname, L"wb");
-		fwrite(data, picsize, 1, dst);
-		free(data);
-		fclose(src);
+		fwrite(file, filesize, 1, dst);
 		fclose(dst);
+		free(file);
+		free(data);
 	}
+	free(base);
 }
 
 int main(int argc, char *argv[])
 {
 	setlocale(LC_ALL, "chs");
-	printf("projectNiflheim-cmvs\nڽpngͼƬתɼ򵥵pb3\nļϵϡ\nby Darkness-TX 2018.11.09\n\n");
+	printf("projectNiflheim-cmvs\nڽpngͼƬתpb3\nļϵϡ\nѡڶָbasepicļڵpngļͬߴͼΪv6ͼһΪv5\nby Darkness-TX 2018.11.09\n\n");
+	WCHAR basepic[MAX_PATH];
+	if (argc > 2)
+		MultiByteToWideChar(CP_ACP, 0, argv[2], -1, basepic, MAX_PATH);
 	process_dir(argv[1]);
-	WritePngFile();
+	WritePngFile(argc > 2 ? basepic : NULL);
 	printf("ɣļ%d\n", FileNum);
 	system("pause");
 	return 0;